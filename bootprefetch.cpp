@@ -0,0 +1,182 @@
+#include "bootprefetch.h"
+
+// STL
+#include <memory>
+#include <algorithm>
+
+// PUT
+#include <put/object.h>
+
+// Director
+#include "configloader.h"
+#include "workerpool.h"
+
+// POSIX
+#include <fcntl.h>
+#include <unistd.h>
+
+struct pending_prefetch_t
+{
+  posix::size_t remaining; // files not yet hinted
+  TimerWheel::handle_t timer;
+  std::function<void(void)> issued;
+};
+
+// the kernel reads the file in the background, nothing here waits for the data
+static void prefetch_file(const std::string& path) noexcept
+{
+  posix::fd_t fd = posix::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if(fd == posix::error_response)
+    return;
+#if defined(POSIX_FADV_WILLNEED)
+  ::posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+#endif
+  posix::close(fd);
+}
+
+// /proc files report no size: read until the end
+static bool read_proc_file(const std::string& path, std::string& buffer) noexcept
+{
+  posix::fd_t fd = posix::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if(fd == posix::error_response)
+    return false;
+  char chunk[4096];
+  posix::ssize_t length;
+  buffer.clear();
+  while((length = ::read(fd, chunk, sizeof(chunk))) > 0)
+    buffer.append(chunk, posix::size_t(length));
+  posix::close(fd);
+  return length == 0;
+}
+
+// files mapped by a process: "address perms offset dev inode path"
+static void mapped_files(pid_t pid, std::set<std::string>& files) noexcept
+{
+  std::string buffer;
+  if(!read_proc_file("/proc/" + std::to_string(pid) + "/maps", buffer))
+    return;
+
+  std::string::size_type pos = 0;
+  while(pos < buffer.size())
+  {
+    std::string::size_type end = buffer.find('\n', pos);
+    if(end == std::string::npos)
+      end = buffer.size();
+    std::string::size_type path = buffer.find('/', pos);
+    if(path < end)
+    {
+      std::string file = buffer.substr(path, end - path);
+      if(file.compare(0, sizeof("/dev/") - 1, "/dev/") && // not a device or shared memory AND
+         file.compare(0, sizeof("/memfd:") - 1, "/memfd:") && // not an anonymous file AND
+         file.find(" (deleted)") == std::string::npos) // still exists
+        files.emplace(std::move(file));
+    }
+    pos = end + 1;
+  }
+}
+
+// run 'issued' once: whichever comes first of the last hint and the deadline
+static void finish_prefetch(const std::shared_ptr<pending_prefetch_t>& pending) noexcept
+{
+  if(pending->timer)
+    TimerWheel::instance().cancel(pending->timer);
+  pending->timer = 0;
+  if(pending->issued)
+  {
+    std::function<void(void)> issued;
+    std::swap(issued, pending->issued);
+    issued();
+  }
+}
+
+BootPrefetch::BootPrefetch(const char* list_path) noexcept
+  : m_list_path(list_path),
+    m_recorded_loaded(false),
+    m_recorded(false)
+{
+}
+
+void BootPrefetch::prefetch(std::vector<std::string> paths, std::function<void(void)> issued) noexcept
+{
+  if(!m_recorded_loaded) // what the last boot mapped (libraries, data files)
+  {
+    m_recorded_loaded = true;
+    std::string buffer;
+    if(read_config_file(m_list_path.c_str(), buffer))
+    {
+      std::string::size_type pos = 0;
+      while(pos < buffer.size())
+      {
+        std::string::size_type end = buffer.find('\n', pos);
+        if(end == std::string::npos)
+          end = buffer.size();
+        if(end > pos)
+          paths.emplace_back(buffer.substr(pos, end - pos));
+        pos = end + 1;
+      }
+    }
+  }
+
+  paths.erase(std::remove_if(paths.begin(), paths.end(),
+                             [](const std::string& path) noexcept { return path.empty() || path.front() != '/'; }),
+              paths.end());
+  std::sort(paths.begin(), paths.end());
+  paths.erase(std::unique(paths.begin(), paths.end()), paths.end());
+
+  if(paths.empty())
+  {
+    Object::singleShot(issued);
+    return;
+  }
+
+  std::shared_ptr<pending_prefetch_t> pending = std::make_shared<pending_prefetch_t>();
+  pending->remaining = paths.size();
+  pending->issued = issued;
+  pending->timer = TimerWheel::instance().schedule(DIRECTOR_PREFETCH_WAIT,
+                                                   [pending]() noexcept
+                                                   {
+                                                     pending->timer = 0; // has fired
+                                                     finish_prefetch(pending);
+                                                   });
+
+  for(std::string& path : paths)
+    WorkerPool::instance().post([path]() noexcept { prefetch_file(path); },
+                                [pending]() noexcept
+                                {
+                                  if(!--pending->remaining)
+                                    finish_prefetch(pending);
+                                });
+}
+
+std::set<std::string> BootPrefetch::mappedFiles(const std::vector<pid_t>& pids) noexcept
+{
+  std::set<std::string> files;
+  for(pid_t pid : pids)
+    mapped_files(pid, files);
+  return files;
+}
+
+void BootPrefetch::record(std::set<std::string> files) noexcept
+{
+  m_recorded = true;
+  if(files.empty()) // keep the last list rather than record nothing
+    return;
+  const std::string list_path = m_list_path;
+  WorkerPool::instance().post(
+        [files, list_path]() noexcept
+        {
+          std::string buffer;
+          for(const std::string& file : files)
+            buffer.append(file).push_back('\n');
+
+          std::string temporary(list_path);
+          temporary.append(".").append(std::to_string(posix::getpid()));
+          posix::fd_t fd = posix::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+          if(fd == posix::error_response)
+            return;
+          bool ok = ::write(fd, buffer.data(), buffer.size()) == posix::ssize_t(buffer.size());
+          posix::close(fd);
+          if(!ok || ::rename(temporary.c_str(), list_path.c_str()) != posix::success_response) // replace atomically
+            ::unlink(temporary.c_str());
+        });
+}
@@ -0,0 +1,57 @@
+#ifndef BOOTPREFETCH_H
+#define BOOTPREFETCH_H
+
+// STL
+#include <set>
+#include <string>
+#include <vector>
+#include <functional>
+
+// PUT
+#include <put/cxxutils/posix_helpers.h>
+
+// Director
+#include "timerwheel.h"
+
+#ifndef DIRECTOR_USERNAME
+#define DIRECTOR_USERNAME       "director"
+#endif
+
+#ifndef DIRECTOR_CACHE_DIR
+#define DIRECTOR_CACHE_DIR      "/var/cache/" DIRECTOR_USERNAME
+#endif
+
+#ifndef DIRECTOR_PREFETCH_LIST
+#define DIRECTOR_PREFETCH_LIST  DIRECTOR_CACHE_DIR "/prefetch.list"
+#endif
+
+#ifndef DIRECTOR_PREFETCH_WAIT
+#define DIRECTOR_PREFETCH_WAIT  250 // milliseconds the first provider waits for the read ahead hints to be issued
+#endif
+
+// Asks the kernel to read the files a boot needs (provider executables and the files they mapped
+// during the last boot) before the providers fault them in one at a time.
+// Each file is opened and hinted on the worker pool so slow disks see the requests together.
+class BootPrefetch
+{
+public:
+  BootPrefetch(const char* list_path = DIRECTOR_PREFETCH_LIST) noexcept;
+
+  // hint 'paths' (and on the first call, the recorded list), 'issued' runs once they are all hinted or the wait is over
+  void prefetch(std::vector<std::string> paths, std::function<void(void)> issued) noexcept;
+
+  // files mapped by 'pids': the maps of other users' processes are only readable with privileges, so this runs on the caller's thread
+  static std::set<std::string> mappedFiles(const std::vector<pid_t>& pids) noexcept;
+
+  // replace the recorded list with 'files' (written on the worker pool)
+  void record(std::set<std::string> files) noexcept;
+
+  bool isRecorded(void) const noexcept { return m_recorded; }
+
+private:
+  const std::string m_list_path;
+  bool m_recorded_loaded; // the recorded list was added to a prefetch
+  bool m_recorded; // this boot has been recorded
+};
+
+#endif // BOOTPREFETCH_H
@@ -0,0 +1,57 @@
+#ifndef CHANGESET_H
+#define CHANGESET_H
+
+// STL
+#include <string>
+#include <map>
+#include <set>
+
+// Director
+#include "configmap.h"
+
+// configuration changes accumulated between reloads
+struct changeset_t
+{
+  bool everything; // data was replaced wholesale
+  bool configs_changed; // a config was created or emptied
+  std::map<std::string, std::set<std::string>> keys; // changed keys by config name (empty name for unnamed data)
+
+  changeset_t(void) noexcept : everything(false), configs_changed(false) { }
+
+  bool empty(void) const noexcept { return !everything && !configs_changed && keys.empty(); }
+
+  void clear(void) noexcept
+  {
+    everything = false;
+    configs_changed = false;
+    keys.clear();
+  }
+
+  void add(const std::string& config, const std::string& key) noexcept
+  {
+    if(!everything) // no need to track details
+      keys[config].emplace(key);
+  }
+
+  void merge(const changeset_t& other) noexcept
+  {
+    everything |= other.everything;
+    configs_changed |= other.configs_changed;
+    for(const auto& pair : other.keys)
+      keys[pair.first].insert(pair.second.begin(), pair.second.end());
+  }
+
+  // true if any changed key (or removed subtree) could affect keys starting with 'prefix'
+  bool touches(const std::string& prefix) const noexcept
+  {
+    if(everything)
+      return true;
+    for(const auto& pair : keys)
+      for(const std::string& key : pair.second)
+        if(prefix_related(key, prefix))
+          return true;
+    return false;
+  }
+};
+
+#endif // CHANGESET_H
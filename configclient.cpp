@@ -8,9 +8,8 @@
 #include <put/cxxutils/hashing.h>
 #include <put/cxxutils/syslogstream.h>
 
-#ifndef SCFS_PATH
-#define SCFS_PATH               "/svc"
-#endif
+// Director
+#include "snapshot.h"
 
 #ifndef CONFIG_CONFIG_PATH
 #define CONFIG_CONFIG_PATH      "/etc/" CONFIG_USERNAME
@@ -26,46 +25,47 @@
 #define UNABLE_TO_PARSE_CONFIGURATION           0x12
 
 #ifndef NO_CONFIG_FALLBACK
-#include <put/cxxutils/configmanip.h>
+#include "configloader.h"
+#endif
 
-static bool readconfig(const char* name, std::string& buffer) noexcept
+static vfifo subscription(const std::vector<std::string>& prefixes) noexcept
 {
-  posix::FILE* file = posix::fopen(name, "rb");
-
-  if(file == nullptr)
-  {
-    posix::syslog << posix::priority::warning
-                  << "Unable to open file: %1 : %2"
-                  << name
-                  << posix::strerror(errno)
-                  << posix::eom;
-    return false;
-  }
-
-  buffer.clear();
-  buffer.resize(posix::size_t(posix::ftell(file)), '\n');
-  if(buffer.size())
-  {
-    posix::rewind(file);
-    posix::fread(const_cast<char*>(buffer.data()), sizeof(std::string::value_type), buffer.size(), file);
-  }
-  posix::fclose(file);
-  return true;
+  vfifo buffer;
+  buffer << "RPC" << "subscribeCall" << uint32_t(prefixes.size());
+  for(const std::string& prefix : prefixes)
+    buffer << prefix;
+  return buffer;
 }
 
-#endif
-
-ConfigClient::ConfigClient(void) noexcept
-  : m_sync(false)
+ConfigClient::ConfigClient(const std::string& socket_path) noexcept
+  : m_socket_path(socket_path),
+    m_sync(false),
+    m_generation(0),
+    m_server_instance(0),
+    m_unacknowledged(0),
+    m_pending_sync(sync_request_t::none),
+    m_fast_sync(true),
+    m_sync_timer(0),
+    m_in_transaction(false)
 {
   Object::connect(newMessage, this, &ConfigClient::receive);
+#ifndef NO_CONFIG_FALLBACK
+  Object::connect(m_watcher.filesChanged, this, &ConfigClient::filesChanged);
+  Object::connect(m_watcher.overflowed  , this, &ConfigClient::reloadFile);
+#endif
   Object::singleShot(this, &ConfigClient::resync, errno = posix::success_response);
 }
 
+ConfigClient::~ConfigClient(void) noexcept
+{
+  if(m_sync_timer)
+    TimerWheel::instance().cancel(m_sync_timer);
+}
+
 void ConfigClient::resync(posix::error_t errcode) noexcept
 {
-  m_data.clear();
   m_sync = false;
+  syncAnswered(); // nothing is waiting on the old connection
   if(isConnected())
     disconnect();
 
@@ -75,10 +75,26 @@ void ConfigClient::resync(posix::error_t errcode) noexcept
     // connection counter stuff here
   }
 
+  if(m_unacknowledged || !m_transaction.empty() || // local changes may differ from the server data (a delta would keep them) OR
+     !m_fast_sync) // the server can only send everything
+    m_generation = 0;
+  m_unacknowledged = 0; // answers to earlier connections are lost
+
+  if(!m_generation) // if a delta can't be requested
+  {
+    m_data.clear(); // start from nothing
+    m_changes.everything = true;
+  }
+
   if(try_connecting &&
-     connect(SCFS_PATH CONFIG_IO_SOCKET) &&
-     write(vfifo("RPC", "syncCall"), posix::invalid_descriptor)) // no errors!
+     connect(m_socket_path.c_str()) &&
+     (m_subscriptions.empty() || // the server filters the sync that follows
+      write(subscription(m_subscriptions), posix::invalid_descriptor)) &&
+     requestSync()) // no errors!
   {
+#ifndef NO_CONFIG_FALLBACK
+    m_watcher.unwatch(); // the server is authoritative again
+#endif
   }
   else
   {
@@ -87,12 +103,12 @@ void ConfigClient::resync(posix::error_t errcode) noexcept
       if(!isConnected())
         posix::syslog << posix::priority::warning
                       << "Unable to connect to socket file %1"
-                      << SCFS_PATH CONFIG_IO_SOCKET
+                      << m_socket_path
                       << posix::eom;
       else
         posix::syslog << posix::priority::warning
                       << "Connection error for %1 : %2"
-                      << SCFS_PATH CONFIG_IO_SOCKET
+                      << m_socket_path
                       << posix::strerror(errno)
                       << posix::eom;
     }
@@ -103,50 +119,224 @@ void ConfigClient::resync(posix::error_t errcode) noexcept
                   << "Continuing without configuration provider connection.  Falling back on direct file access."
                   << posix::eom;
 
-    std::string buffer;
-    ConfigManip tmp_config;
-    if(!readconfig(CONFIG_CONFIG_PATH "/" DIRECTOR_CONFIG_FILE, buffer))
+    m_data.clear(); // file data has no generation
+    m_generation = 0;
+    m_changes.everything = true;
+
+    if(load_config_file(CONFIG_CONFIG_PATH "/" DIRECTOR_CONFIG_FILE, m_data))
     {
-      posix::syslog << posix::priority::critical
-                    << "Unable to read Director provider configuation file: %1 : %2"
-                    << (CONFIG_CONFIG_PATH "/" DIRECTOR_CONFIG_FILE)
-                    << posix::strerror(errno)
-                    << posix::eom;
+      dropUnsubscribed(m_data);
+      if(!m_watcher.isWatching() && !m_watcher.watch(CONFIG_CONFIG_PATH))
+        posix::syslog << posix::priority::warning
+                      << "Unable to watch %1 for changes.  Edits will be ignored until a resync."
+                      << CONFIG_CONFIG_PATH
+                      << posix::eom;
+      m_sync = true;
+      Object::enqueue(synchronized);
     }
-    else if(!tmp_config.importText(buffer))
+#endif
+  }
+}
+
+// the local data may hold changes the server never applied: request everything
+void ConfigClient::fullResync(posix::error_t errcode) noexcept
+{
+  m_generation = 0;
+  resync(errcode);
+}
+
+// only what changed or everything at once when the server can, otherwise everything streamed (every server can)
+bool ConfigClient::requestSync(void) noexcept
+{
+  if(!m_fast_sync)
+  {
+    m_pending_sync = sync_request_t::full;
+    return write(vfifo("RPC", "syncCall"), posix::invalid_descriptor);
+  }
+
+  if(m_generation && m_server_instance) // a generation only means something to the server that numbered it
+  {
+    m_pending_sync = sync_request_t::delta;
+    if(!write(vfifo("RPC", "syncDeltaCall", m_server_instance, m_generation), posix::invalid_descriptor))
+      return false;
+  }
+  else
+  {
+    m_pending_sync = sync_request_t::snapshot;
+    if(!write(vfifo("RPC", "syncSnapshotCall"), posix::invalid_descriptor))
+      return false;
+  }
+  m_sync_timer = TimerWheel::instance().schedule(CONFIG_SYNC_TIMEOUT, [this]() noexcept { syncTimedOut(); });
+  return true;
+}
+
+void ConfigClient::requestFullSync(void) noexcept
+{
+  m_data.clear();
+  m_generation = 0;
+  m_changes.everything = true;
+  m_pending_sync = sync_request_t::full;
+  if(!write(vfifo("RPC", "syncCall"), posix::invalid_descriptor))
+    Object::singleShot(this, &ConfigClient::resync, errno);
+}
+
+void ConfigClient::syncAnswered(void) noexcept
+{
+  if(m_sync_timer)
+    TimerWheel::instance().cancel(m_sync_timer);
+  m_sync_timer = 0;
+  m_pending_sync = sync_request_t::none;
+}
+
+// servers that predate snapshots and deltas ignore the request
+void ConfigClient::syncTimedOut(void) noexcept
+{
+  m_sync_timer = 0; // has fired
+  posix::syslog << posix::priority::notice
+                << "No answer to a snapshot or delta request from %1.  Requesting full syncs instead."
+                << m_socket_path
+                << posix::eom;
+  m_fast_sync = false;
+  requestFullSync();
+}
+
+#ifndef NO_CONFIG_FALLBACK
+void ConfigClient::filesChanged(std::set<std::string> filenames) noexcept
+{
+  if(filenames.find(DIRECTOR_CONFIG_FILE) != filenames.end())
+    reloadFile();
+}
+
+// re-import the file through the same paths that server updates use
+void ConfigClient::reloadFile(void) noexcept
+{
+  configmap_t file_data;
+  if(isConnected() || // if the server is authoritative OR
+     !load_config_file(CONFIG_CONFIG_PATH "/" DIRECTOR_CONFIG_FILE, file_data)) // keep the old data while the file is unusable
+    return;
+  dropUnsubscribed(file_data);
+
+  const configmap_t current = m_data; // copy because it is modified below
+  for(const auto& pair : current)
+    if(file_data.find(pair.first) == file_data.end())
+      valueUnset(pair.first);
+
+  for(const auto& pair : file_data)
+  {
+    auto iter = m_data.find(pair.first);
+    if(iter == m_data.end() || iter->second != pair.second)
+      valueSet(pair.first, pair.second);
+  }
+
+  if(!m_changes.empty())
+    Object::enqueue(updated);
+}
+#endif
+
+changeset_t ConfigClient::takeChanges(void) noexcept
+{
+  if(!m_changes.empty()) // readers of the previous snapshot keep it
+    publish();
+
+  changeset_t changes;
+  std::swap(changes, m_changes);
+  return changes;
+}
+
+// copy the subtrees a change touched, share the others
+void ConfigClient::publish(void) noexcept
+{
+  config_view_t previous = m_published.load();
+  std::shared_ptr<config_snapshot_t> next = std::make_shared<config_snapshot_t>();
+  next->generation = m_generation;
+
+  std::set<std::string> touched;
+  if(m_changes.everything)
+  {
+    for(const auto& pair : m_data)
+      touched.insert(config_subtree(pair.first));
+  }
+  else
+  {
+    next->subtrees = previous->subtrees; // only the pointers are copied
+    auto changed = m_changes.keys.find(std::string());
+    if(changed != m_changes.keys.end())
+      for(const std::string& key : changed->second)
+      {
+        touched.insert(config_subtree(key));
+        for(auto range = prefix_range(previous->subtrees, key); range.first != range.second; ++range.first)
+          touched.insert(range.first->first); // unsetting a parent ("/") removes whole subtrees
+      }
+  }
+
+  for(const std::string& name : touched)
+  {
+    if(name.size() < 2) // "/" is not a subtree: its children were listed above
+      continue;
+    std::shared_ptr<configmap_t> subtree = std::make_shared<configmap_t>();
+    if(name.back() == '/')
     {
-      posix::syslog << posix::priority::critical
-                    << "Parsing failed will processing Director provider configuation file: %1"
-                    << (CONFIG_CONFIG_PATH "/" DIRECTOR_CONFIG_FILE)
-                    << posix::eom;
+      auto range = prefix_range(m_data, name);
+      subtree->insert(range.first, range.second);
     }
-    else // no errors! :)
+    else // a top level value
     {
-      tmp_config.exportKeyPairs(m_data);
-      m_sync = true;
-      Object::enqueue(synchronized);
+      auto iter = m_data.find(name);
+      if(iter != m_data.end())
+        subtree->insert(*iter);
     }
-#endif
+
+    if(subtree->empty())
+      next->subtrees.erase(name);
+    else
+      next->subtrees[name] = subtree;
   }
+  m_published.store(next);
 }
 
-void ConfigClient::valueSet(const std::string& key, const std::string& value) noexcept
+bool ConfigClient::isSubscribed(const std::string& key) const noexcept
 {
-  m_data[key] = value;
+  if(m_subscriptions.empty())
+    return true;
+  for(const std::string& prefix : m_subscriptions)
+    if(prefix_related(key, prefix))
+      return true;
+  return false;
 }
 
-void ConfigClient::valueUnset(const std::string& key) noexcept
+void ConfigClient::dropUnsubscribed(configmap_t& data) const noexcept
 {
-  auto pos = m_data.begin();
-  while(pos != m_data.end()) // search for key or children
+  for(auto iter = data.begin(); iter != data.end(); )
   {
-    if(pos->first.find(key) == 0) // key starts with search key (could be a child)
-      pos = m_data.erase(pos); // delete it
+    if(isSubscribed(iter->first))
+      ++iter;
     else
-      ++pos;
+      iter = data.erase(iter);
   }
 }
 
+void ConfigClient::subscribe(const std::vector<std::string>& prefixes) noexcept
+{
+  m_subscriptions = prefixes;
+  if(isConnected()) // data for new prefixes was never sent
+  {
+    m_generation = 0;
+    Object::singleShot(this, &ConfigClient::resync, errno = posix::success_response);
+  }
+}
+
+void ConfigClient::valueSet(std::string key, std::string value) noexcept
+{
+  m_changes.add(std::string(), key);
+  assign_value(m_data, std::move(key), std::move(value));
+}
+
+void ConfigClient::valueUnset(const std::string& key) noexcept
+{
+  m_changes.add(std::string(), key);
+  erase_prefix(m_data, key); // delete key and children
+}
+
 const std::string& ConfigClient::get(const std::string& key) const noexcept
 {
   static std::string nullvalue;
@@ -159,21 +349,63 @@ const std::string& ConfigClient::get(const std::string& key) const noexcept
 void ConfigClient::set(const std::string& key, const std::string& value) noexcept
 {
   valueSet(key, value);
-  if(isConnected() && !write(vfifo("RPC", "setCall", key, value), posix::invalid_descriptor))
-    Object::singleShot(this, &ConfigClient::resync, errno);
+  if(m_in_transaction)
+    m_transaction.push_back({ true, key, value });
+  else if(isConnected())
+  {
+    if(write(vfifo("RPC", "setCall", key, value), posix::invalid_descriptor))
+      ++m_unacknowledged; // resynchronized in full if it is never answered
+    else
+      Object::singleShot(this, &ConfigClient::fullResync, errno);
+  }
 }
 
 void ConfigClient::unset(const std::string& key) noexcept
 {
   valueUnset(key);
-  if(isConnected() && !write(vfifo("RPC", "unsetCall", key), posix::invalid_descriptor))
-    Object::singleShot(this, &ConfigClient::resync, errno);
+  if(m_in_transaction)
+    m_transaction.push_back({ false, key, std::string() });
+  else if(isConnected())
+  {
+    if(write(vfifo("RPC", "unsetCall", key), posix::invalid_descriptor))
+      ++m_unacknowledged; // resynchronized in full if it is never answered
+    else
+      Object::singleShot(this, &ConfigClient::fullResync, errno);
+  }
+}
+
+void ConfigClient::begin(void) noexcept
+{
+  m_in_transaction = true;
+}
+
+bool ConfigClient::commit(void) noexcept
+{
+  m_in_transaction = false;
+  if(m_transaction.empty())
+    return true;
+
+  vfifo buffer;
+  buffer << "RPC" << "batchCall" << uint32_t(m_transaction.size());
+  for(const change_t& change : m_transaction)
+    buffer << (change.is_set ? "set" : "unset") << change.key << change.value;
+  m_transaction.clear();
+
+  if(isConnected())
+  {
+    if(!write(buffer, posix::invalid_descriptor))
+    {
+      Object::singleShot(this, &ConfigClient::fullResync, errno);
+      return false;
+    }
+    ++m_unacknowledged;
+  }
+  return true;
 }
 
 void ConfigClient::receive(posix::fd_t socket, vfifo buffer, posix::fd_t fd) noexcept
 {
   (void)socket;
-  (void)fd;
   posix::error_t errcode;
   std::string str, key, value;
   if(!(buffer >> str).hadError() && str == "RPC" &&
@@ -183,48 +415,134 @@ void ConfigClient::receive(posix::fd_t socket, vfifo buffer, posix::fd_t fd) noe
     {
       case "syncReturn"_hash:
       {
+        if(m_pending_sync != sync_request_t::full) // not asked for on this connection
+          break;
+        syncAnswered();
         buffer >> errcode;
         if(buffer.hadError() || errcode != posix::success_response)
-          Object::singleShot(this, &ConfigClient::resync, errcode);
+          Object::singleShot(this, &ConfigClient::fullResync, errcode);
         else if(errcode == posix::success_response)
+        {
+          if((buffer >> m_server_instance >> m_generation).hadError()) // if the server does not version its data
+            m_server_instance = m_generation = 0;
+          m_sync = true;
+          Object::enqueue(synchronized);
+        }
+      }
+      break;
+      case "syncSnapshotReturn"_hash:
+      {
+        uint32_t entry_count = 0;
+        if(m_pending_sync != sync_request_t::snapshot) // answered after giving up on it
+        {
+          m_fast_sync = true; // the server is slow, not old
+          break;
+        }
+        syncAnswered();
+        buffer >> errcode >> m_server_instance >> m_generation;
+        m_data.clear();
+        m_changes.everything = true;
+        if(!buffer.hadError() &&
+           errcode == posix::success_response &&
+           read_snapshot(fd, CONFIG_SNAPSHOT_MAGIC, 2, entry_count,
+                         [this](const snapshot_field_t* fields) noexcept
+                           {
+                             std::string key(fields[0].data, fields[0].size);
+                             if(isSubscribed(key))
+                               m_data.emplace(std::move(key), std::string(fields[1].data, fields[1].size));
+                           })) // the whole configuration was read from the snapshot
         {
           m_sync = true;
           Object::enqueue(synchronized);
         }
+        else // no usable snapshot: fall back to a streamed full sync
+        {
+          requestFullSync();
+        }
+      }
+      break;
+      case "syncDeltaReturn"_hash:
+      {
+        if(m_pending_sync != sync_request_t::delta) // answered after giving up on it
+        {
+          m_fast_sync = true; // the server is slow, not old
+          break;
+        }
+        syncAnswered();
+        uint64_t instance = 0;
+        buffer >> errcode >> instance >> m_generation;
+        if(!buffer.hadError() && errcode == posix::success_response &&
+           instance == m_server_instance) // changes since our generation have been applied by the same server
+        {
+          m_sync = true;
+          Object::enqueue(synchronized);
+        }
+        else // the server cannot serve the delta: fall back to a full sync
+        {
+          requestFullSync();
+        }
+      }
+      break;
+      case "generation"_hash: // follows every change set the server applies
+      {
+        uint64_t instance = 0;
+        buffer >> instance >> m_generation;
+        if(buffer.hadError() || instance != m_server_instance)
+          m_generation = 0; // can no longer trust the generation
+        if(m_sync)
+          Object::enqueue(updated); // one notification per change set
+      }
+      break;
+      case "subscribeReturn"_hash: // servers without subscriptions are filtered locally
+        break;
+      case "batchReturn"_hash:
+      {
+        uint32_t count = 0;
+        if(m_unacknowledged)
+          --m_unacknowledged;
+        buffer >> errcode >> count;
+        if(buffer.hadError() || errcode != posix::success_response) // the batch was rejected: our data holds it
+          Object::singleShot(this, &ConfigClient::fullResync, errcode);
       }
       break;
       case "valueSet"_hash:
       {
         buffer >> key >> value;
         if(buffer.hadError())
-          Object::singleShot(this, &ConfigClient::resync, errcode);
-        else
-          valueSet(key, value);
+          Object::singleShot(this, &ConfigClient::fullResync, errcode);
+        else if(isSubscribed(key)) // servers without subscriptions push every key
+          valueSet(std::move(key), std::move(value));
       }
       break;
       case "valueUnset"_hash:
       {
         buffer >> key;
         if(buffer.hadError())
-          Object::singleShot(this, &ConfigClient::resync, errcode);
-        else
+          Object::singleShot(this, &ConfigClient::fullResync, errcode);
+        else if(isSubscribed(key))
           valueUnset(key);
       }
       break;
       case "unsetReturn"_hash:
       {
+        if(m_unacknowledged)
+          --m_unacknowledged;
         buffer >> errcode >> key;
         if(buffer.hadError() || errcode != posix::success_response)
-          Object::singleShot(this, &ConfigClient::resync, errcode);
+          Object::singleShot(this, &ConfigClient::fullResync, errcode);
       }
       break;
       case "setReturn"_hash:
       {
+        if(m_unacknowledged)
+          --m_unacknowledged;
         buffer >> errcode >> key;
         if(buffer.hadError() || errcode != posix::success_response)
-          Object::singleShot(this, &ConfigClient::resync, errcode);
+          Object::singleShot(this, &ConfigClient::fullResync, errcode);
       }
       break;
     }
   }
+  if(fd != posix::invalid_descriptor) // no passed descriptor is kept
+    posix::close(fd);
 }
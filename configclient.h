@@ -4,6 +4,7 @@
 // STL
 #include <atomic>
 #include <vector>
+#include <list>
 #include <string>
 
 // PUT
@@ -11,6 +12,20 @@
 #include <put/cxxutils/vfifo.h>
 #include <put/cxxutils/posix_helpers.h>
 
+// Director
+#include "changeset.h"
+#include "configmap.h"
+#include "configsnapshot.h"
+#include "timerwheel.h"
+
+#ifndef NO_CONFIG_FALLBACK
+#include "configwatcher.h"
+#endif
+
+#ifndef SCFS_PATH
+#define SCFS_PATH               "/svc"
+#endif
+
 #ifndef CONFIG_USERNAME
 #define CONFIG_USERNAME         "config"
 #endif
@@ -22,24 +37,69 @@
 class ConfigClient : public ClientSocket
 {
 public:
-  ConfigClient(void) noexcept;
+  ConfigClient(const std::string& socket_path = SCFS_PATH CONFIG_IO_SOCKET) noexcept;
+  ~ConfigClient(void) noexcept;
 
   const std::string& get(const std::string& key) const noexcept;
   void set  (const std::string& key, const std::string& value) noexcept;
   void unset(const std::string& key) noexcept;
 
+  // only keep (and ask the server to only push) keys under these prefixes (empty for every key)
+  void subscribe(const std::vector<std::string>& prefixes) noexcept;
+
+  void begin (void) noexcept; // collect set/unset calls until commit()
+  bool commit(void) noexcept; // apply collected calls atomically in one round trip
+
   bool isSynchronized(void) const noexcept { return m_sync; }
   signal<> synchronized;
+  signal<> updated; // the server applied a set of changes
+
+  changeset_t takeChanges(void) noexcept; // changes since the last call (publishes a new snapshot)
+  config_view_t snapshot(void) const noexcept { return m_published.load(); } // data as of the last takeChanges()
 
-  const std::unordered_map<std::string, std::string>& data(void) const { return m_data; }
+  const configmap_t& data(void) const { return m_data; }
 private:
   void resync(posix::error_t errcode) noexcept;
+  void publish(void) noexcept;
+  void fullResync(posix::error_t errcode) noexcept; // after an error: local data can't be trusted
+  bool requestSync(void) noexcept;
+  void requestFullSync(void) noexcept;
+  void syncAnswered(void) noexcept;
+  void syncTimedOut(void) noexcept;
   void receive(posix::fd_t socket, vfifo buffer, posix::fd_t fd) noexcept;
-  void valueSet(const std::string& key, const std::string& value) noexcept;
+  void valueSet(std::string key, std::string value) noexcept; // by value: received strings are moved into storage
   void valueUnset(const std::string& key) noexcept;
+  bool isSubscribed(const std::string& key) const noexcept;
+  void dropUnsubscribed(configmap_t& data) const noexcept;
+#ifndef NO_CONFIG_FALLBACK
+  void filesChanged(std::set<std::string> filenames) noexcept;
+  void reloadFile(void) noexcept;
+#endif
 
-  std::unordered_map<std::string, std::string> m_data;
+  configmap_t m_data;
+  struct change_t
+  {
+    bool is_set;
+    std::string key;
+    std::string value;
+  };
+
+  std::string m_socket_path;
   std::atomic_bool m_sync;
+  uint64_t m_generation; // server data generation, zero when unknown
+  uint64_t m_server_instance; // server process the generation belongs to (generations restart with it), zero when unknown
+  uint32_t m_unacknowledged; // local changes sent that the server has not answered yet
+  sync_request_t m_pending_sync;
+  bool m_fast_sync; // the server answers snapshot and delta requests (assumed until one goes unanswered)
+  TimerWheel::handle_t m_sync_timer;
+  bool m_in_transaction;
+  std::list<change_t> m_transaction;
+  changeset_t m_changes;
+  PublishedSnapshot<config_snapshot_t> m_published;
+  std::vector<std::string> m_subscriptions;
+#ifndef NO_CONFIG_FALLBACK
+  ConfigWatcher m_watcher; // reports edits while in fallback mode
+#endif
 };
 
 #endif
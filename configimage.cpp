@@ -0,0 +1,459 @@
+#include "configimage.h"
+
+// POSIX
+#include <dirent.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+
+// STL
+#include <map>
+#include <algorithm>
+
+#ifndef CONFIG_IMAGE_BOOT_ID
+#define CONFIG_IMAGE_BOOT_ID  "/proc/sys/kernel/random/boot_id"
+#endif
+
+struct config_image_header_t
+{
+  uint32_t magic;
+  uint32_t version;
+  uint64_t generation;
+  uint64_t server_instance;
+  uint64_t epoch;
+  int64_t stamp_seconds;
+  int64_t stamp_nanoseconds;
+  uint64_t stamp_bytes;
+  uint64_t stamp_identity;
+  uint32_t file_count;
+  uint32_t string_count;
+  uint32_t provider_count;
+  uint32_t entry_count;
+  uint32_t index_size; // a power of two
+  uint32_t strings_size;
+};
+
+struct config_image_string_t
+{
+  uint32_t offset;
+  uint32_t length;
+};
+
+struct config_image_provider_t
+{
+  strid_t name;
+  uint32_t first_entry;
+  uint32_t entry_count;
+};
+
+namespace
+{
+  constexpr uint32_t empty_slot = UINT32_MAX;
+
+  // FNV-1a: the index is written by one build and read by another
+  uint32_t name_hash(const char* data, posix::size_t length) noexcept
+  {
+    uint32_t value = 2166136261u;
+    for(posix::size_t i = 0; i < length; ++i)
+      value = (value ^ uint8_t(data[i])) * 16777619u;
+    return value;
+  }
+
+  uint64_t mix(uint64_t value) noexcept // splitmix64 finalizer
+  {
+    value ^= value >> 30;
+    value *= 0xbf58476d1ce4e5b9ull;
+    value ^= value >> 27;
+    value *= 0x94d049bb133111ebull;
+    return value ^ (value >> 31);
+  }
+
+  // deduplicating string table builder: IDs are assigned in order of first use
+  class string_table_t
+  {
+  public:
+    strid_t add(const std::string& str) noexcept
+    {
+      auto rval = m_ids.emplace(str, strid_t(m_records.size()));
+      if(rval.second) // if newly added
+      {
+        m_records.push_back({ uint32_t(m_data.size()), uint32_t(str.size()) });
+        m_data.append(str);
+      }
+      return rval.first->second;
+    }
+    const std::vector<config_image_string_t>& records(void) const noexcept { return m_records; }
+    const std::string& data(void) const noexcept { return m_data; }
+  private:
+    std::unordered_map<std::string, strid_t> m_ids;
+    std::vector<config_image_string_t> m_records;
+    std::string m_data;
+  };
+
+  bool write_all(posix::fd_t fd, const void* data, posix::size_t size) noexcept
+  {
+    const char* pos = static_cast<const char*>(data);
+    while(size)
+    {
+      posix::ssize_t count = ::write(fd, pos, size);
+      if(count <= 0)
+      {
+        if(count < 0 && errno == EINTR)
+          continue;
+        return false;
+      }
+      pos += count;
+      size -= posix::size_t(count);
+    }
+    return true;
+  }
+}
+
+bool config_source_stamp(const char* directory, config_image_stamp_t& stamp) noexcept
+{
+  static const char suffix[] = ".conf";
+  struct stat info;
+
+  if(::stat(directory, &info) != posix::success_response) // directory mtime covers added and removed files
+    return false;
+
+  stamp.seconds = info.st_mtim.tv_sec;
+  stamp.nanoseconds = info.st_mtim.tv_nsec;
+  stamp.bytes = 0;
+  stamp.identity = 0;
+  stamp.file_count = 0;
+
+  DIR* dir = ::opendir(directory);
+  if(dir == nullptr)
+    return false;
+
+  std::string filename;
+  for(dirent* entry = ::readdir(dir); entry != nullptr; entry = ::readdir(dir))
+  {
+    posix::size_t length = posix::strlen(entry->d_name);
+    if(entry->d_name[0] == '.' ||
+       length <= sizeof(suffix) - 1 ||
+       posix::strcmp(entry->d_name + length - (sizeof(suffix) - 1), suffix))
+      continue;
+
+    filename.assign(directory).append(1, '/').append(entry->d_name);
+    if(::stat(filename.c_str(), &info) == posix::success_response)
+    {
+      ++stamp.file_count;
+      stamp.bytes += uint64_t(info.st_size);
+      stamp.identity += mix(uint64_t(info.st_ino) ^ // a sum does not depend on the directory order
+                            mix(uint64_t(info.st_size) ^
+                                mix(uint64_t(info.st_mtim.tv_sec) * 1000000000ull + uint64_t(info.st_mtim.tv_nsec))));
+      if(info.st_mtim.tv_sec > stamp.seconds ||
+         (info.st_mtim.tv_sec == stamp.seconds && info.st_mtim.tv_nsec > stamp.nanoseconds))
+      {
+        stamp.seconds = info.st_mtim.tv_sec;
+        stamp.nanoseconds = info.st_mtim.tv_nsec;
+      }
+    }
+  }
+  ::closedir(dir);
+  return true;
+}
+
+uint64_t config_image_epoch(void) noexcept
+{
+  static uint64_t epoch = 0;
+  if(!epoch)
+  {
+    char buffer[64];
+    posix::fd_t fd = posix::open(CONFIG_IMAGE_BOOT_ID, O_RDONLY | O_CLOEXEC);
+    if(fd == posix::error_response)
+      return 0;
+    posix::ssize_t length = ::read(fd, buffer, sizeof(buffer));
+    posix::close(fd);
+    if(length <= 0)
+      return 0;
+    epoch = 14695981039346656037ull; // FNV-1a of the boot ID
+    for(posix::ssize_t i = 0; i < length; ++i)
+      epoch = (epoch ^ uint8_t(buffer[i])) * 1099511628211ull;
+    if(!epoch)
+      epoch = 1;
+  }
+  return epoch;
+}
+
+bool write_config_image(const char* path,
+                        uint64_t generation,
+                        uint64_t server_instance,
+                        uint64_t epoch,
+                        const config_image_stamp_t& stamp,
+                        const std::unordered_map<std::string, configmap_t>& configs) noexcept
+{
+  std::map<std::string, const configmap_t*> sorted; // records are ordered by provider name
+  for(const auto& pair : configs)
+    sorted.emplace(pair.first, &pair.second);
+
+  string_table_t strings;
+  std::vector<config_image_provider_t> providers;
+  std::vector<ConfigTable::entry_t> entries;
+  providers.reserve(sorted.size());
+
+  for(const auto& pair : sorted)
+  {
+    providers.push_back({ strings.add(pair.first), uint32_t(entries.size()), uint32_t(pair.second->size()) });
+    for(const auto& entry : *pair.second) // configmap_t is already ordered by key
+      entries.push_back({ strings.add(entry.first), strings.add(entry.second) });
+  }
+
+  uint32_t index_size = 1;
+  while(index_size < providers.size() * 2) // at most half full
+    index_size <<= 1;
+  std::vector<uint32_t> index(index_size, empty_slot);
+  for(uint32_t p = 0; p < providers.size(); ++p)
+  {
+    const config_image_string_t& name = strings.records()[providers[p].name];
+    uint32_t slot = name_hash(strings.data().data() + name.offset, name.length) & (index_size - 1);
+    while(index[slot] != empty_slot)
+      slot = (slot + 1) & (index_size - 1);
+    index[slot] = p;
+  }
+
+  config_image_header_t header;
+  posix::memset(&header, 0, sizeof(header));
+  header.magic = CONFIG_IMAGE_MAGIC;
+  header.version = CONFIG_IMAGE_VERSION;
+  header.generation = generation;
+  header.server_instance = server_instance;
+  header.epoch = epoch;
+  header.stamp_seconds = stamp.seconds;
+  header.stamp_nanoseconds = stamp.nanoseconds;
+  header.stamp_bytes = stamp.bytes;
+  header.stamp_identity = stamp.identity;
+  header.file_count = stamp.file_count;
+  header.string_count = uint32_t(strings.records().size());
+  header.provider_count = uint32_t(providers.size());
+  header.entry_count = uint32_t(entries.size());
+  header.index_size = index_size;
+  header.strings_size = uint32_t(strings.data().size());
+
+  std::string temporary(path);
+  temporary.append(".").append(std::to_string(posix::getpid()));
+
+  posix::fd_t fd = posix::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if(fd == posix::error_response)
+    return false;
+
+  bool ok = write_all(fd, &header, sizeof(header)) &&
+            write_all(fd, strings.records().data(), strings.records().size() * sizeof(config_image_string_t)) &&
+            write_all(fd, providers.data(), providers.size() * sizeof(config_image_provider_t)) &&
+            write_all(fd, entries.data(), entries.size() * sizeof(ConfigTable::entry_t)) &&
+            write_all(fd, index.data(), index.size() * sizeof(uint32_t)) &&
+            write_all(fd, strings.data().data(), strings.data().size()) &&
+            ::fsync(fd) == posix::success_response;
+  posix::close(fd);
+
+  if(!ok || ::rename(temporary.c_str(), path) != posix::success_response) // replace atomically
+  {
+    ::unlink(temporary.c_str());
+    return false;
+  }
+  return true;
+}
+
+ConfigImage::ConfigImage(void) noexcept
+  : m_mapping(MAP_FAILED),
+    m_size(0),
+    m_header(nullptr),
+    m_strings(nullptr),
+    m_providers(nullptr),
+    m_entries(nullptr),
+    m_index(nullptr),
+    m_string_data(nullptr)
+{
+}
+
+ConfigImage::~ConfigImage(void) noexcept
+{
+  close();
+}
+
+void ConfigImage::close(void) noexcept
+{
+  if(m_mapping != MAP_FAILED)
+    ::munmap(m_mapping, m_size);
+  m_mapping = MAP_FAILED;
+  m_size = 0;
+  m_header = nullptr;
+}
+
+bool ConfigImage::open(const char* path) noexcept
+{
+  close();
+  posix::fd_t fd = posix::open(path, O_RDONLY | O_CLOEXEC);
+  if(fd == posix::error_response)
+    return false;
+
+  struct stat info;
+  if(::fstat(fd, &info) == posix::success_response &&
+     info.st_size >= posix::ssize_t(sizeof(config_image_header_t)))
+  {
+    m_size = posix::size_t(info.st_size);
+    m_mapping = ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  }
+  posix::close(fd);
+  if(m_mapping == MAP_FAILED)
+    return false;
+
+  const char* base = static_cast<const char*>(m_mapping);
+  const config_image_header_t* header = reinterpret_cast<const config_image_header_t*>(base);
+  const uint64_t strings_offset = sizeof(config_image_header_t);
+  const uint64_t providers_offset = strings_offset + uint64_t(header->string_count) * sizeof(config_image_string_t);
+  const uint64_t entries_offset = providers_offset + uint64_t(header->provider_count) * sizeof(config_image_provider_t);
+  const uint64_t index_offset = entries_offset + uint64_t(header->entry_count) * sizeof(ConfigTable::entry_t);
+  const uint64_t data_offset = index_offset + uint64_t(header->index_size) * sizeof(uint32_t);
+
+  if(header->magic != CONFIG_IMAGE_MAGIC ||
+     header->version != CONFIG_IMAGE_VERSION ||
+     data_offset + header->strings_size != m_size)
+  {
+    close();
+    return false;
+  }
+
+  m_header = header;
+  m_strings = reinterpret_cast<const config_image_string_t*>(base + strings_offset);
+  m_providers = reinterpret_cast<const config_image_provider_t*>(base + providers_offset);
+  m_entries = reinterpret_cast<const ConfigTable::entry_t*>(base + entries_offset);
+  m_index = reinterpret_cast<const uint32_t*>(base + index_offset);
+  m_string_data = base + data_offset;
+
+  if(!validate()) // accessors trust every record from here on
+  {
+    close();
+    return false;
+  }
+  return true;
+}
+
+bool ConfigImage::validate(void) const noexcept
+{
+  if(!m_header->index_size ||
+     (m_header->index_size & (m_header->index_size - 1)) || // not a power of two OR
+     m_header->index_size < m_header->provider_count) // too small to hold every provider
+    return false;
+
+  for(uint32_t s = 0; s < m_header->string_count; ++s)
+    if(uint64_t(m_strings[s].offset) + m_strings[s].length > m_header->strings_size)
+      return false;
+
+  for(uint32_t p = 0; p < m_header->provider_count; ++p)
+    if(m_providers[p].name >= m_header->string_count ||
+       uint64_t(m_providers[p].first_entry) + m_providers[p].entry_count > m_header->entry_count)
+      return false;
+
+  for(uint32_t e = 0; e < m_header->entry_count; ++e)
+    if(m_entries[e].key >= m_header->string_count ||
+       m_entries[e].value >= m_header->string_count)
+      return false;
+
+  for(uint32_t slot = 0; slot < m_header->index_size; ++slot)
+    if(m_index[slot] != empty_slot && m_index[slot] >= m_header->provider_count)
+      return false;
+  return true;
+}
+
+uint64_t ConfigImage::generation(void) const noexcept
+{
+  return m_header == nullptr ? 0 : m_header->generation;
+}
+
+uint64_t ConfigImage::serverInstance(void) const noexcept
+{
+  return m_header == nullptr ? 0 : m_header->server_instance;
+}
+
+uint64_t ConfigImage::epoch(void) const noexcept
+{
+  return m_header == nullptr ? 0 : m_header->epoch;
+}
+
+config_image_stamp_t ConfigImage::stamp(void) const noexcept
+{
+  if(m_header == nullptr)
+    return { 0, 0, 0, 0, 0 };
+  return { m_header->stamp_seconds, m_header->stamp_nanoseconds, m_header->stamp_bytes, m_header->stamp_identity, m_header->file_count };
+}
+
+uint32_t ConfigImage::providerCount(void) const noexcept
+{
+  return m_header == nullptr ? 0 : m_header->provider_count;
+}
+
+uint32_t ConfigImage::stringCount(void) const noexcept
+{
+  return m_header == nullptr ? 0 : m_header->string_count;
+}
+
+std::string ConfigImage::providerName(uint32_t provider) const noexcept
+{
+  const config_image_string_t& name = m_strings[m_providers[provider].name];
+  return std::string(m_string_data + name.offset, name.length);
+}
+
+bool ConfigImage::equals(uint32_t id, const std::string& str) const noexcept
+{
+  return m_strings[id].length == str.size() &&
+         !posix::memcmp(m_string_data + m_strings[id].offset, str.data(), str.size());
+}
+
+int ConfigImage::compare(uint32_t id, const std::string& str) const noexcept
+{
+  const config_image_string_t& record = m_strings[id];
+  int rval = posix::memcmp(m_string_data + record.offset, str.data(), std::min<posix::size_t>(record.length, str.size()));
+  if(rval)
+    return rval;
+  return record.length < str.size() ? -1 : record.length > str.size() ? 1 : 0;
+}
+
+bool ConfigImage::findProvider(const std::string& name, uint32_t& provider) const noexcept
+{
+  if(m_header == nullptr)
+    return false;
+  const uint32_t mask = m_header->index_size - 1;
+  for(uint32_t slot = name_hash(name.data(), name.size()) & mask, probes = 0;
+      probes < m_header->index_size && m_index[slot] != empty_slot;
+      slot = (slot + 1) & mask, ++probes)
+    if(equals(m_providers[m_index[slot]].name, name))
+    {
+      provider = m_index[slot];
+      return true;
+    }
+  return false;
+}
+
+bool ConfigImage::get(uint32_t provider, const std::string& key, std::string& value) const noexcept
+{
+  const ConfigTable::entry_t* first = m_entries + m_providers[provider].first_entry;
+  const ConfigTable::entry_t* last = first + m_providers[provider].entry_count;
+  const ConfigTable::entry_t* pos = std::lower_bound(first, last, key,
+                                                     [this](const ConfigTable::entry_t& entry, const std::string& str) noexcept
+                                                       { return compare(entry.key, str) < 0; });
+  if(pos == last || !equals(pos->key, key))
+    return false;
+  value.assign(m_string_data + m_strings[pos->value].offset, m_strings[pos->value].length);
+  return true;
+}
+
+ConfigTable ConfigImage::table(uint32_t provider, const std::shared_ptr<StringPool>& pool, std::vector<strid_t>& ids) const noexcept
+{
+  ids.resize(m_header->string_count, strid_t(StringPool::invalid_id)); // by value: invalid_id has no out of line definition
+  auto intern = [this, &pool, &ids](strid_t id) noexcept
+  {
+    if(ids[id] == StringPool::invalid_id) // first use of this image string
+      ids[id] = pool->intern(std::string(m_string_data + m_strings[id].offset, m_strings[id].length));
+    return ids[id];
+  };
+
+  const config_image_provider_t& record = m_providers[provider];
+  std::vector<ConfigTable::entry_t> entries;
+  entries.reserve(record.entry_count);
+  for(uint32_t e = record.first_entry; e < record.first_entry + record.entry_count; ++e) // already ordered by key
+    entries.push_back({ intern(m_entries[e].key), intern(m_entries[e].value) });
+  return ConfigTable(pool, std::move(entries));
+}
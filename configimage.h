@@ -0,0 +1,107 @@
+#ifndef CONFIGIMAGE_H
+#define CONFIGIMAGE_H
+
+// STL
+#include <string>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+
+// PUT
+#include <put/cxxutils/posix_helpers.h>
+
+// Director
+#include "configmap.h"
+#include "configtable.h"
+#include "stringpool.h"
+
+// Compiled configuration image, mapped read-only at startup instead of parsing text configs.
+// layout (native byte order):
+//   header
+//   string records: every distinct string once, its ID is its index
+//   provider records (sorted by name), each naming a contiguous run of entries
+//   entry records (key ID, value ID) sorted by key within each provider: the layout of ConfigTable::entry_t
+//   provider index: open addressing hash table of provider record indexes
+//   string data
+#define CONFIG_IMAGE_MAGIC    0x53584349 // "SXCI"
+#define CONFIG_IMAGE_VERSION  3
+
+// identifies the state of the source files an image was compiled from
+struct config_image_stamp_t
+{
+  int64_t seconds; // newest modification of the directory or a config file
+  int64_t nanoseconds;
+  uint64_t bytes; // total size of the config files
+  uint64_t identity; // combined inode, size and modification time of every config file (catches files replaced by older ones)
+  uint32_t file_count;
+
+  bool operator ==(const config_image_stamp_t& other) const noexcept
+  {
+    return seconds == other.seconds &&
+           nanoseconds == other.nanoseconds &&
+           bytes == other.bytes &&
+           identity == other.identity &&
+           file_count == other.file_count;
+  }
+  bool operator !=(const config_image_stamp_t& other) const noexcept { return !operator ==(other); }
+};
+
+// stamp of the "*.conf" files of a directory
+bool config_source_stamp(const char* directory, config_image_stamp_t& stamp) noexcept;
+
+// identifies this boot: server generations are only comparable within one (zero if unknown)
+uint64_t config_image_epoch(void) noexcept;
+
+// write to a temporary file and rename it over 'path'
+bool write_config_image(const char* path,
+                        uint64_t generation, // server data generation (zero for images of files)
+                        uint64_t server_instance, // server process that numbered 'generation' (zero for images of files)
+                        uint64_t epoch, // config_image_epoch() of the server data (zero for images of files)
+                        const config_image_stamp_t& stamp,
+                        const std::unordered_map<std::string, configmap_t>& configs) noexcept;
+
+struct config_image_header_t;
+struct config_image_string_t;
+struct config_image_provider_t;
+
+// An image mapped read-only: every record is checked once by open() and then read in place.
+class ConfigImage
+{
+public:
+  ConfigImage(void) noexcept;
+  ~ConfigImage(void) noexcept;
+
+  bool open(const char* path) noexcept; // false if the image is missing, malformed or of another version
+  void close(void) noexcept;
+  bool isOpen(void) const noexcept { return m_header != nullptr; }
+
+  uint64_t generation(void) const noexcept;
+  uint64_t serverInstance(void) const noexcept;
+  uint64_t epoch(void) const noexcept;
+  config_image_stamp_t stamp(void) const noexcept;
+
+  uint32_t providerCount(void) const noexcept;
+  std::string providerName(uint32_t provider) const noexcept;
+  bool findProvider(const std::string& name, uint32_t& provider) const noexcept; // through the prebuilt index
+  bool get(uint32_t provider, const std::string& key, std::string& value) const noexcept; // binary search of the entries
+
+  // the entries of 'provider' as a table of 'pool': each image string is interned once for every table ('ids' remembers them)
+  ConfigTable table(uint32_t provider, const std::shared_ptr<StringPool>& pool, std::vector<strid_t>& ids) const noexcept;
+  uint32_t stringCount(void) const noexcept;
+
+private:
+  bool validate(void) const noexcept;
+  bool equals(uint32_t id, const std::string& str) const noexcept;
+  int compare(uint32_t id, const std::string& str) const noexcept;
+
+  void* m_mapping;
+  posix::size_t m_size;
+  const config_image_header_t* m_header;
+  const config_image_string_t* m_strings;
+  const config_image_provider_t* m_providers;
+  const ConfigTable::entry_t* m_entries;
+  const uint32_t* m_index;
+  const char* m_string_data;
+};
+
+#endif // CONFIGIMAGE_H
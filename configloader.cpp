@@ -0,0 +1,325 @@
+#include "configloader.h"
+
+// POSIX
+#include <dirent.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+// STL
+#include <vector>
+#include <memory>
+#include <algorithm>
+
+#ifndef SINGLE_THREADED_APPLICATION
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#endif
+
+// PUT
+#include <put/cxxutils/posix_helpers.h>
+#include <put/cxxutils/syslogstream.h>
+#include <put/cxxutils/configmanip.h>
+
+// Director
+#include "workerpool.h"
+
+bool read_config_file(const char* name, std::string& buffer) noexcept
+{
+  posix::fd_t fd = posix::open(name, O_RDONLY | O_CLOEXEC);
+  if(fd == posix::error_response)
+    return false;
+
+  struct stat info;
+  bool ok = ::fstat(fd, &info) == posix::success_response;
+  buffer.clear();
+  if(ok)
+  {
+    // read() rather than mmap(): a file truncated by an editor while it is copied must not raise SIGBUS
+    buffer.resize(info.st_size > 0 ? posix::size_t(info.st_size) : 0);
+    posix::size_t used = 0;
+    posix::ssize_t length;
+    for(;;)
+    {
+      if(used == buffer.size()) // the file grew (or reports no size): make room for more
+        buffer.resize(buffer.size() + 4096);
+      length = ::read(fd, &buffer[used], buffer.size() - used);
+      if(length > 0)
+        used += posix::size_t(length);
+      else if(length == 0 || errno != EINTR) // end of file or error
+        break;
+    }
+    ok = length == 0;
+    buffer.resize(used);
+  }
+  int error = errno; // preserve the error across close()
+  posix::close(fd);
+  errno = error;
+  return ok;
+}
+
+bool load_config_file(const char* name, configmap_t& data) noexcept
+{
+  std::string buffer;
+  ConfigManip config;
+  if(!read_config_file(name, buffer))
+  {
+    posix::syslog << posix::priority::critical
+                  << "Unable to read configuation file: %1 : %2"
+                  << name
+                  << posix::strerror(errno)
+                  << posix::eom;
+    return false;
+  }
+
+  if(!config.importText(buffer))
+  {
+    posix::syslog << posix::priority::critical
+                  << "Parsing failed will processing configuation file: %1"
+                  << name
+                  << posix::eom;
+    return false;
+  }
+
+  std::unordered_map<std::string, std::string> pairs;
+  config.exportKeyPairs(pairs);
+  data.clear();
+  data.insert(pairs.begin(), pairs.end());
+  return true;
+}
+
+namespace
+{
+  const char suffix[] = ".conf";
+
+  // "<provider>.conf" to "<provider>"
+  bool provider_of(const char* filename, std::string& provider) noexcept
+  {
+    posix::size_t length = posix::strlen(filename);
+    if(filename[0] == '.' || // skip dot files/dirs
+       length <= sizeof(suffix) - 1 || // if too short OR
+       posix::strcmp(filename + length - (sizeof(suffix) - 1), suffix)) // doesn't end with ".conf"
+      return false;
+    provider.assign(filename, length - (sizeof(suffix) - 1));
+    return true;
+  }
+
+  struct file_job_t
+  {
+    enum status_t : uint8_t { cached, unreadable, unparsable, parsed };
+
+    std::string provider;
+    std::string filename;
+    struct stat info;
+    status_t status;
+    int error;
+    configmap_t data;
+  };
+
+  // runs on the worker pool: no logging and no shared state
+  void parse_file(file_job_t& job) noexcept
+  {
+    std::string buffer;
+    ConfigManip config;
+    if(!read_config_file(job.filename.c_str(), buffer))
+    {
+      job.status = file_job_t::unreadable;
+      job.error = errno;
+    }
+    else if(!config.importText(buffer))
+      job.status = file_job_t::unparsable;
+    else
+    {
+      std::unordered_map<std::string, std::string> pairs;
+      config.exportKeyPairs(pairs);
+      job.data.insert(pairs.begin(), pairs.end());
+      job.status = file_job_t::parsed;
+    }
+  }
+
+#ifndef SINGLE_THREADED_APPLICATION
+  // files to parse, shared by the loading thread and the worker pool
+  struct parse_batch_t
+  {
+    std::vector<file_job_t*> files;
+    std::atomic_size_t next;
+    posix::size_t done;
+    std::mutex mutex;
+    std::condition_variable finished;
+  };
+
+  // take files until none are left: work that starts late finds nothing to do
+  void parse_files(parse_batch_t& batch) noexcept
+  {
+    for(size_t index = batch.next++; index < batch.files.size(); index = batch.next++)
+    {
+      parse_file(*batch.files[index]);
+      std::lock_guard<std::mutex> lock(batch.mutex);
+      if(++batch.done == batch.files.size())
+        batch.finished.notify_all();
+    }
+  }
+#endif
+
+  inline bool same_file(const struct stat& info, ino_t inode, const struct timespec& mtime, off_t size) noexcept
+  {
+    return info.st_ino == inode &&
+           info.st_size == size &&
+           info.st_mtim.tv_sec == mtime.tv_sec &&
+           info.st_mtim.tv_nsec == mtime.tv_nsec;
+  }
+}
+
+bool ConfigDirectoryLoader::load(const char* directory, std::unordered_map<std::string, configmap_t>& configs) noexcept
+{
+  std::vector<file_job_t> jobs;
+  std::vector<file_job_t*> pending;
+
+  m_parsed_count = 0;
+
+  DIR* dir = ::opendir(directory);
+  if(dir == nullptr)
+    return false;
+
+  for(dirent* entry = ::readdir(dir); entry != nullptr; entry = ::readdir(dir))
+  {
+    std::string provider;
+    if(!provider_of(entry->d_name, provider))
+      continue; // skip file
+
+    jobs.emplace_back();
+    file_job_t& job = jobs.back();
+    job.provider = std::move(provider);
+    job.filename.assign(directory).append(1, '/').append(entry->d_name);
+    job.error = posix::success_response;
+    job.status = file_job_t::unreadable;
+    if(::stat(job.filename.c_str(), &job.info) != posix::success_response)
+      job.error = errno;
+  }
+  ::closedir(dir);
+
+  for(file_job_t& job : jobs)
+  {
+    if(job.error != posix::success_response) // couldn't stat it
+      continue;
+    auto iter = m_cache.find(job.provider);
+    if(iter != m_cache.end() &&
+       same_file(job.info, iter->second.inode, iter->second.mtime, iter->second.size))
+      job.status = file_job_t::cached;
+    else
+      pending.push_back(&job);
+  }
+
+#ifdef SINGLE_THREADED_APPLICATION
+  for(file_job_t* job : pending)
+    parse_file(*job);
+#else
+  // parse the changed files on the worker pool, the calling thread takes files too
+  std::shared_ptr<parse_batch_t> batch = std::make_shared<parse_batch_t>();
+  batch->files = pending;
+  batch->next = 0;
+  batch->done = 0;
+  size_t takers = std::min<size_t>(pending.size(), WORKERPOOL_THREADS + 1); // every pool thread and this one
+  for(size_t i = 1; i < takers; ++i)
+    WorkerPool::instance().post([batch]() noexcept { parse_files(*batch); });
+  parse_files(*batch);
+
+  std::unique_lock<std::mutex> lock(batch->mutex); // the last files may still be parsing
+  batch->finished.wait(lock, [&batch]() noexcept { return batch->done == batch->files.size(); });
+  lock.unlock();
+#endif
+
+  m_parsed_count = pending.size();
+
+  // merge results and refresh the cache
+  std::unordered_map<std::string, cached_t> cache;
+  for(file_job_t& job : jobs)
+  {
+    switch(job.status)
+    {
+      case file_job_t::unreadable:
+        posix::syslog << posix::priority::critical
+                      << "Unable to read Director configuation file: %1 : %2"
+                      << job.filename
+                      << posix::strerror(job.error)
+                      << posix::eom;
+        break;
+
+      case file_job_t::unparsable:
+        posix::syslog << posix::priority::critical
+                      << "Parsing failed will processing Director configuation file: %1"
+                      << job.filename
+                      << posix::eom;
+        break;
+
+      case file_job_t::cached:
+      {
+        auto iter = m_cache.find(job.provider);
+        if(!iter->second.data.empty()) // configs only exist when they have data
+          configs[job.provider] = iter->second.data;
+        cache.emplace(job.provider, std::move(iter->second));
+        break;
+      }
+
+      case file_job_t::parsed:
+      {
+        if(!job.data.empty()) // configs only exist when they have data
+          configs[job.provider] = job.data;
+        cached_t& entry = cache[job.provider];
+        entry.inode = job.info.st_ino;
+        entry.mtime = job.info.st_mtim;
+        entry.size = job.info.st_size;
+        entry.data = std::move(job.data);
+        break;
+      }
+    }
+  }
+  m_cache.swap(cache); // drop entries for files that are gone
+  return true;
+}
+
+bool ConfigDirectoryLoader::loadFile(const char* directory, const std::string& filename, std::string& provider, configmap_t& data) noexcept
+{
+  if(!provider_of(filename.c_str(), provider))
+    return false;
+
+  file_job_t job;
+  job.provider = provider;
+  job.filename.assign(directory).append(1, '/').append(filename);
+  data.clear();
+
+  if(::stat(job.filename.c_str(), &job.info) != posix::success_response)
+  {
+    if(errno != ENOENT)
+      return false;
+    m_cache.erase(provider); // file was deleted
+    return true;
+  }
+
+  auto iter = m_cache.find(provider);
+  if(iter != m_cache.end() &&
+     same_file(job.info, iter->second.inode, iter->second.mtime, iter->second.size))
+  {
+    data = iter->second.data;
+    return true;
+  }
+
+  parse_file(job);
+  if(job.status != file_job_t::parsed)
+  {
+    posix::syslog << posix::priority::critical
+                  << "Unable to load Director configuation file: %1"
+                  << job.filename
+                  << posix::eom;
+    return false;
+  }
+
+  cached_t& entry = m_cache[provider];
+  entry.inode = job.info.st_ino;
+  entry.mtime = job.info.st_mtim;
+  entry.size = job.info.st_size;
+  entry.data = job.data;
+  data = std::move(job.data);
+  return true;
+}
@@ -0,0 +1,47 @@
+#ifndef CONFIGLOADER_H
+#define CONFIGLOADER_H
+
+// STL
+#include <string>
+#include <unordered_map>
+
+// POSIX
+#include <sys/types.h>
+#include <time.h>
+
+// Director
+#include "configmap.h"
+
+// read a whole file through a memory mapping
+bool read_config_file(const char* name, std::string& buffer) noexcept;
+
+// read and parse a config file (errors are logged)
+bool load_config_file(const char* name, configmap_t& data) noexcept;
+
+// Loads every "<provider>.conf" file of a directory.
+// Files are memory mapped and parsed on the worker pool and
+// files with the same inode, modification time and size as the last load reuse the last parse.
+class ConfigDirectoryLoader
+{
+public:
+  bool load(const char* directory, std::unordered_map<std::string, configmap_t>& configs) noexcept;
+
+  // reload one file of the directory: 'data' is left empty if the file was deleted
+  // returns false if it is not a config file or could not be read
+  bool loadFile(const char* directory, const std::string& filename, std::string& provider, configmap_t& data) noexcept;
+
+  size_t lastParsedCount(void) const noexcept { return m_parsed_count; } // files parsed by the last load
+
+private:
+  struct cached_t
+  {
+    ino_t inode;
+    struct timespec mtime;
+    off_t size;
+    configmap_t data;
+  };
+  std::unordered_map<std::string, cached_t> m_cache; // indexed by provider name
+  size_t m_parsed_count = 0;
+};
+
+#endif // CONFIGLOADER_H
@@ -0,0 +1,61 @@
+#ifndef CONFIGMAP_H
+#define CONFIGMAP_H
+
+// STL
+#include <string>
+#include <map>
+#include <utility>
+
+// key ordered so that every subtree ("/Process/...") is one contiguous range
+typedef std::map<std::string, std::string> configmap_t;
+
+// smallest string greater than every string starting with prefix (empty when there is none)
+inline std::string prefix_successor(std::string prefix) noexcept
+{
+  while(!prefix.empty() && static_cast<unsigned char>(prefix.back()) == 0xFF)
+    prefix.pop_back();
+  if(!prefix.empty())
+    prefix.back() = char(static_cast<unsigned char>(prefix.back()) + 1);
+  return prefix;
+}
+
+// set a value, moving both strings into the map
+inline void assign_value(configmap_t& map, std::string&& key, std::string&& value) noexcept
+{
+  auto iter = map.lower_bound(key);
+  if(iter != map.end() && iter->first == key)
+    iter->second = std::move(value);
+  else
+    map.emplace_hint(iter, std::move(key), std::move(value));
+}
+
+// true if 'key' is within 'prefix' or is a parent of it (unsetting a parent removes the subtree)
+inline bool prefix_related(const std::string& key, const std::string& prefix) noexcept
+{
+  return !key.compare(0, prefix.size(), prefix) ||
+         !prefix.compare(0, key.size(), key);
+}
+
+// entries whose keys start with prefix in O(log n)
+template<typename map_type>
+std::pair<typename map_type::const_iterator, typename map_type::const_iterator>
+  prefix_range(const map_type& map, const std::string& prefix) noexcept
+{
+  std::string successor = prefix_successor(prefix);
+  return std::make_pair(map.lower_bound(prefix),
+                        successor.empty() ? map.end() : map.lower_bound(successor));
+}
+
+// remove a key and all of its children in O(log n + matches)
+template<typename map_type>
+typename map_type::size_type erase_prefix(map_type& map, const std::string& prefix) noexcept
+{
+  std::string successor = prefix_successor(prefix);
+  auto first = map.lower_bound(prefix);
+  auto last  = successor.empty() ? map.end() : map.lower_bound(successor);
+  typename map_type::size_type count = typename map_type::size_type(std::distance(first, last));
+  map.erase(first, last);
+  return count;
+}
+
+#endif // CONFIGMAP_H
@@ -0,0 +1,99 @@
+#ifndef CONFIGSNAPSHOT_H
+#define CONFIGSNAPSHOT_H
+
+// STL
+#include <string>
+#include <map>
+#include <memory>
+#include <unordered_map>
+
+// Director
+#include "configmap.h"
+#include "configtable.h"
+
+#ifndef CONFIG_SYNC_TIMEOUT
+#define CONFIG_SYNC_TIMEOUT     2000 // milliseconds a server has to answer a snapshot or delta request
+#endif
+
+// the sync request a client is waiting on: servers predating snapshots and deltas never answer them
+enum class sync_request_t : uint8_t
+{
+  none,
+  full, // syncCall
+  snapshot, // syncSnapshotCall
+  delta, // syncDeltaCall
+};
+
+// Immutable views of the config data.  The event loop publishes a new snapshot whenever the
+// accumulated changes are taken, any thread may hold one for as long as it needs a consistent view.
+
+// top level subtree of a key: "/Settings/InitialRunlevel" is in "/Settings/"
+inline std::string config_subtree(const std::string& key) noexcept
+{
+  std::string::size_type end = key.find('/', 1);
+  return end == std::string::npos ? key : key.substr(0, end + 1);
+}
+
+// subtrees that no change touched are shared with the previous snapshot
+struct config_snapshot_t
+{
+  uint64_t generation = 0;
+  std::map<std::string, std::shared_ptr<const configmap_t>> subtrees; // by config_subtree()
+
+  // every entry of a top level subtree ("/Runlevels/")
+  const configmap_t& subtree(const std::string& name) const noexcept
+  {
+    static const configmap_t nullmap;
+    auto iter = subtrees.find(name);
+    return iter == subtrees.end() ? nullmap : *iter->second;
+  }
+
+  const std::string& get(const std::string& key) const noexcept
+  {
+    static const std::string nullvalue;
+    const configmap_t& data = subtree(config_subtree(key));
+    auto iter = data.find(key);
+    return iter == data.end() ? nullvalue : iter->second;
+  }
+};
+
+// tables of unchanged configs are shared with the previous snapshot, each table keeps its strings alive
+struct director_config_snapshot_t
+{
+  uint64_t generation = 0;
+  std::unordered_map<std::string, ConfigTable> configs;
+
+  const ConfigTable& data(const std::string& config) const noexcept
+  {
+    static const ConfigTable nullval;
+    auto iter = configs.find(config);
+    return iter == configs.end() ? nullval : iter->second;
+  }
+
+  const std::string& get(const std::string& config, const std::string& key) const noexcept
+  {
+    static const std::string nullvalue;
+    const ConfigTable& table = data(config);
+    auto iter = table.find(key);
+    return iter == table.end() ? nullvalue : (*iter).second;
+  }
+};
+
+typedef std::shared_ptr<const config_snapshot_t> config_view_t;
+typedef std::shared_ptr<const director_config_snapshot_t> director_config_view_t;
+
+// the current snapshot: replaced by the event loop, loaded by any thread (readers only wait for the pointer swap)
+template<typename snapshot_type>
+class PublishedSnapshot
+{
+public:
+  PublishedSnapshot(void) noexcept : m_current(std::make_shared<const snapshot_type>()) { }
+
+  std::shared_ptr<const snapshot_type> load(void) const noexcept { return std::atomic_load(&m_current); }
+  void store(std::shared_ptr<const snapshot_type> snapshot) noexcept { std::atomic_store(&m_current, std::move(snapshot)); }
+
+private:
+  std::shared_ptr<const snapshot_type> m_current;
+};
+
+#endif // CONFIGSNAPSHOT_H
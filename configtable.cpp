@@ -0,0 +1,96 @@
+#include "configtable.h"
+
+// STL
+#include <algorithm>
+
+// heap bytes used by a std::string beyond the object itself (libstdc++ stores up to 15 characters inline)
+static size_t string_heap_bytes(const std::string& str) noexcept
+{
+  return str.capacity() > 15 ? str.capacity() + 1 : 0;
+}
+
+ConfigTable::ConfigTable(const configmap_t& data) noexcept
+  : m_pool(std::make_shared<StringPool>())
+{
+  m_entries.reserve(data.size());
+  for(const auto& pair : data) // already ordered by key
+    m_entries.push_back({ m_pool->intern(pair.first), m_pool->intern(pair.second) });
+}
+
+std::vector<ConfigTable::entry_t>::iterator ConfigTable::lowerBound(const std::string& key) noexcept
+{
+  return std::lower_bound(m_entries.begin(), m_entries.end(), key,
+                          [this](const entry_t& entry, const std::string& value) noexcept
+                            { return m_pool->str(entry.key) < value; });
+}
+
+ConfigTable::const_iterator ConfigTable::find(const std::string& key) const noexcept
+{
+  auto pos = const_cast<ConfigTable*>(this)->lowerBound(key);
+  if(pos == m_entries.end() || m_pool->str(pos->key) != key)
+    return end();
+  return const_iterator(m_pool.get(), pos);
+}
+
+bool ConfigTable::set(std::string key, std::string value) noexcept
+{
+  if(!m_pool)
+    m_pool = std::make_shared<StringPool>();
+
+  auto pos = m_entries.empty() || m_pool->str(m_entries.back().key) < key ?
+               m_entries.end() : // sorted input appends
+               lowerBound(key);
+  if(pos != m_entries.end() && m_pool->str(pos->key) == key)
+  {
+    strid_t value_id = m_pool->intern(std::move(value));
+    bool replaced = pos->value != value_id;
+    pos->value = value_id;
+    return replaced;
+  }
+  strid_t key_id = m_pool->intern(std::move(key));
+  m_entries.insert(pos, { key_id, m_pool->intern(std::move(value)) });
+  return false;
+}
+
+size_t ConfigTable::erasePrefix(const std::string& prefix) noexcept
+{
+  auto first = lowerBound(prefix);
+  auto last = first;
+  while(last != m_entries.end() && !m_pool->str(last->key).compare(0, prefix.size(), prefix))
+    ++last;
+  size_t count = size_t(last - first);
+  m_entries.erase(first, last);
+  return count;
+}
+
+void ConfigTable::rebind(const std::shared_ptr<StringPool>& pool) noexcept
+{
+  if(m_pool)
+    for(entry_t& entry : m_entries)
+      entry = { pool->intern(m_pool->str(entry.key)), pool->intern(m_pool->str(entry.value)) };
+  m_pool = pool;
+}
+
+configmap_t ConfigTable::toMap(void) const noexcept
+{
+  configmap_t data;
+  for(const entry_t& entry : m_entries)
+    data.emplace_hint(data.end(), m_pool->str(entry.key), m_pool->str(entry.value));
+  return data;
+}
+
+size_t ConfigTable::tableBytes(void) const noexcept
+{
+  return sizeof(ConfigTable) + m_entries.capacity() * sizeof(entry_t);
+}
+
+size_t ConfigTable::mapBytes(void) const noexcept
+{
+  constexpr size_t node_bytes = sizeof(void*) * 3 + sizeof(int) + sizeof(std::pair<const std::string, std::string>); // red-black tree node
+  size_t bytes = sizeof(configmap_t);
+  for(const entry_t& entry : m_entries)
+    bytes += node_bytes +
+             string_heap_bytes(m_pool->str(entry.key)) +
+             string_heap_bytes(m_pool->str(entry.value));
+  return bytes;
+}
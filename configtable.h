@@ -0,0 +1,80 @@
+#ifndef CONFIGTABLE_H
+#define CONFIGTABLE_H
+
+// STL
+#include <string>
+#include <vector>
+#include <memory>
+#include <utility>
+
+// Director
+#include "configmap.h"
+#include "stringpool.h"
+
+// Compact config table: (key, value) string IDs sorted by key.
+// The strings live in a pool shared by every table of the same data generation so that
+// keys common to all providers ("/Process/Executable", ...) are stored once.
+class ConfigTable
+{
+public:
+  struct entry_t
+  {
+    strid_t key;
+    strid_t value;
+  };
+
+  typedef std::pair<const std::string&, const std::string&> value_type;
+
+  class const_iterator
+  {
+  public:
+    struct arrow_t
+    {
+      value_type pair;
+      const value_type* operator ->(void) const noexcept { return &pair; }
+    };
+
+    const_iterator(const StringPool* pool, std::vector<entry_t>::const_iterator pos) noexcept
+      : m_pool(pool), m_pos(pos) { }
+
+    value_type operator *(void) const noexcept { return value_type(m_pool->str(m_pos->key), m_pool->str(m_pos->value)); }
+    arrow_t operator ->(void) const noexcept { return arrow_t { **this }; }
+    const_iterator& operator ++(void) noexcept { ++m_pos; return *this; }
+    bool operator ==(const const_iterator& other) const noexcept { return m_pos == other.m_pos; }
+    bool operator !=(const const_iterator& other) const noexcept { return m_pos != other.m_pos; }
+
+  private:
+    const StringPool* m_pool;
+    std::vector<entry_t>::const_iterator m_pos;
+  };
+
+  ConfigTable(void) noexcept = default;
+  explicit ConfigTable(const std::shared_ptr<StringPool>& pool) noexcept : m_pool(pool) { }
+  explicit ConfigTable(const configmap_t& data) noexcept; // uses a pool of its own
+  ConfigTable(const std::shared_ptr<StringPool>& pool, std::vector<entry_t> entries) noexcept // sorted by key, IDs of 'pool'
+    : m_pool(pool), m_entries(std::move(entries)) { }
+
+  const_iterator begin(void) const noexcept { return const_iterator(m_pool.get(), m_entries.begin()); }
+  const_iterator end  (void) const noexcept { return const_iterator(m_pool.get(), m_entries.end()); }
+  const_iterator find (const std::string& key) const noexcept;
+
+  bool   empty(void) const noexcept { return m_entries.empty(); }
+  size_t size (void) const noexcept { return m_entries.size(); }
+
+  bool set(std::string key, std::string value) noexcept; // returns true if a value was replaced
+  size_t erasePrefix(const std::string& prefix) noexcept; // remove a key and all of its children
+  void rebind(const std::shared_ptr<StringPool>& pool) noexcept; // move the strings to another pool
+
+  configmap_t toMap(void) const noexcept;
+
+  size_t tableBytes(void) const noexcept; // memory used by this table (shared strings excluded)
+  size_t mapBytes  (void) const noexcept; // estimated memory for the same data in a configmap_t
+
+private:
+  std::vector<entry_t>::iterator lowerBound(const std::string& key) noexcept;
+
+  std::shared_ptr<StringPool> m_pool;
+  std::vector<entry_t> m_entries;
+};
+
+#endif // CONFIGTABLE_H
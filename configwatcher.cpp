@@ -0,0 +1,97 @@
+#include "configwatcher.h"
+
+// PUT
+#include <put/specialized/eventbackend.h>
+
+#if defined(__linux__)
+#include <sys/inotify.h>
+#endif
+
+ConfigWatcher::ConfigWatcher(void) noexcept
+  : m_fd(posix::invalid_descriptor),
+    m_overflowed(false),
+    m_timer(0)
+{
+}
+
+ConfigWatcher::~ConfigWatcher(void) noexcept
+{
+  unwatch();
+}
+
+bool ConfigWatcher::watch(const char* directory) noexcept
+{
+  unwatch();
+#if defined(__linux__)
+  m_fd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if(m_fd == posix::error_response)
+  {
+    m_fd = posix::invalid_descriptor;
+    return false;
+  }
+
+  // editors either rewrite a file in place or write a new file and rename it over the old one
+  if(::inotify_add_watch(m_fd, directory, IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE) == posix::error_response ||
+     !EventBackend::add(m_fd, EventBackend::SimplePollReadFlags,
+                        [this](posix::fd_t, EventBackend::native_flags_t) noexcept { readEvents(); }))
+  {
+    posix::close(m_fd);
+    m_fd = posix::invalid_descriptor;
+    return false;
+  }
+  return true;
+#else
+  (void)directory;
+  return false;
+#endif
+}
+
+void ConfigWatcher::unwatch(void) noexcept
+{
+  if(m_timer)
+    TimerWheel::instance().cancel(m_timer);
+  m_timer = 0;
+  m_pending.clear();
+  m_overflowed = false;
+
+  if(m_fd != posix::invalid_descriptor)
+  {
+    EventBackend::remove(m_fd, EventBackend::SimplePollReadFlags);
+    posix::close(m_fd);
+    m_fd = posix::invalid_descriptor;
+  }
+}
+
+void ConfigWatcher::readEvents(void) noexcept
+{
+#if defined(__linux__)
+  alignas(struct inotify_event) char buffer[4096];
+  posix::ssize_t length;
+  while((length = ::read(m_fd, buffer, sizeof(buffer))) > 0)
+  {
+    for(char* pos = buffer; pos < buffer + length; )
+    {
+      const struct inotify_event* event = reinterpret_cast<const struct inotify_event*>(pos);
+      if(event->mask & IN_Q_OVERFLOW)
+        m_overflowed = true;
+      else if(event->len && event->name[0] != '.') // skip dot files (editor swap files)
+        m_pending.emplace(event->name);
+      pos += sizeof(struct inotify_event) + event->len;
+    }
+  }
+#endif
+
+  if(!m_timer && (m_overflowed || !m_pending.empty())) // report once the edit is done
+    m_timer = TimerWheel::instance().schedule(CONFIG_WATCH_WINDOW,
+                                              [this]() noexcept { m_timer = 0; flush(); });
+}
+
+void ConfigWatcher::flush(void) noexcept
+{
+  if(m_overflowed)
+    Object::enqueue(overflowed);
+  else
+    Object::enqueue_copy(filesChanged, m_pending);
+  m_overflowed = false;
+  m_pending.clear();
+}
@@ -0,0 +1,43 @@
+#ifndef CONFIGWATCHER_H
+#define CONFIGWATCHER_H
+
+// STL
+#include <set>
+#include <string>
+
+// PUT
+#include <put/object.h>
+#include <put/cxxutils/posix_helpers.h>
+
+// Director
+#include "timerwheel.h"
+
+#ifndef CONFIG_WATCH_WINDOW
+#define CONFIG_WATCH_WINDOW  50 // milliseconds to gather the events of a single edit
+#endif
+
+// reports files of a directory that were written, replaced or deleted (Linux only)
+class ConfigWatcher : public Object
+{
+public:
+  ConfigWatcher(void) noexcept;
+  ~ConfigWatcher(void) noexcept;
+
+  bool watch(const char* directory) noexcept;
+  void unwatch(void) noexcept;
+  bool isWatching(void) const noexcept { return m_fd != posix::invalid_descriptor; }
+
+  signal<std::set<std::string>> filesChanged; // file names within the directory
+  signal<> overflowed; // events were lost: every file may have changed
+
+private:
+  void readEvents(void) noexcept;
+  void flush(void) noexcept;
+
+  posix::fd_t m_fd;
+  std::set<std::string> m_pending;
+  bool m_overflowed;
+  TimerWheel::handle_t m_timer; // zero when no flush is pending
+};
+
+#endif // CONFIGWATCHER_H
@@ -92,6 +92,8 @@ void DependencySolver::resolveDependencies(void) noexcept
   // clear existing data
   m_orders_start.clear(); // previously ordered
   m_orders_stop.clear(); // previously ordered
+  m_dependents.clear(); // previously indexed
+  m_provider_depths.clear(); // previously calculated
   m_errors.clear(); // clear error messages
 
   // create node of each config
@@ -156,7 +158,10 @@ void DependencySolver::resolveDependencies(void) noexcept
       if(inverse_dependency_iter == dep_by_service.end())
         queueErrorMessage(service.data, std::string("service.") + active_string(service.is_active) + "." + required_string(service.is_required), "unresolved");
       else if(service.is_active)
+      {
         node->dependencies.emplace(depinfo_t<depnodeptr>{ service.is_required, service.is_active, inverse_dependency_iter->second });
+        m_dependents[inverse_dependency_iter->second->provider_name].emplace(configname); // record reverse edge
+      }
       else
         inverse_dependency_iter->second->dependencies.emplace(depinfo_t<depnodeptr>{ service.is_required, service.is_active, node });
     }
@@ -167,7 +172,10 @@ void DependencySolver::resolveDependencies(void) noexcept
       if(inverse_dependency_iter == dep_by_provider.end())
         queueErrorMessage(provider.data, std::string("provider.") + active_string(provider.is_active) + "." + required_string(provider.is_required), "unresolved");
       else if(provider.is_active)
+      {
         node->dependencies.emplace(depinfo_t<depnodeptr>{ provider.is_required, provider.is_active, inverse_dependency_iter->second });
+        m_dependents[provider.data].emplace(configname); // record reverse edge
+      }
       else
         inverse_dependency_iter->second->dependencies.emplace(depinfo_t<depnodeptr>{ provider.is_required, provider.is_active, node });
     }
@@ -179,6 +187,10 @@ void DependencySolver::resolveDependencies(void) noexcept
   for(const depnodeptr& dep : all_deps)
     m_dep_depths.emplace(dep, dependency_depth(dep, depinfo_t<depnodeptr>{requirement, active, dep}, {}, true));
 
+  // keep depths by name for restart ordering
+  for(const auto& pair : m_dep_depths)
+    m_provider_depths.emplace(pair.first->provider_name, pair.second);
+
   // build a list of to start/stop providers for each runlevel
   for(const depnodeptr& dep : all_deps)
   {
@@ -191,7 +203,7 @@ void DependencySolver::resolveDependencies(void) noexcept
         queueErrorMessage(dep->provider_name, "runlevel." + std::to_string(rl) + ".inactive", "add failed");
   }
 
-  // destroy all cached data
+  // destroy all cached data (the reverse edges and depths are kept in m_dependents and m_provider_depths)
   m_dep_depths.clear();
   for(const depnodeptr& dep : all_deps)
     dep->dependencies.clear();
@@ -236,3 +248,47 @@ DependencySolver::runlevel_actions_t DependencySolver::getRunlevelOrder(const st
   }
   return data; // return ordered list of providers to start/stop for this runlevel
 }
+
+std::set<std::string> DependencySolver::getDependents(const std::string& provider) const noexcept
+{
+  std::set<std::string> dependents;
+  std::queue<std::string> pending;
+  pending.push(provider);
+  while(!pending.empty()) // walk the reverse edges breadth first
+  {
+    auto iter = m_dependents.find(pending.front());
+    pending.pop();
+    if(iter != m_dependents.end())
+      for(const std::string& dependent : iter->second)
+        if(dependent != provider && dependents.emplace(dependent).second) // if not seen before
+          pending.push(dependent);
+  }
+  return dependents; // every provider that directly or indirectly depends on this provider
+}
+
+DependencySolver::runlevel_actions_t DependencySolver::getRestartOrder(const std::string& provider,
+                                                                       const std::set<std::string>& active_providers) const noexcept
+{
+  runlevel_actions_t data;
+  std::set<std::pair<depth_t, std::string>> affected;
+
+  auto depth_of = [this](const std::string& name) noexcept
+  {
+    auto iter = m_provider_depths.find(name);
+    return iter == m_provider_depths.end() ? depth_t(0) : iter->second;
+  };
+
+  for(const std::string& dependent : getDependents(provider))
+    if(active_providers.count(dependent)) // only running dependents need restarting
+      affected.emplace(depth_of(dependent), dependent);
+
+  for(auto iter = affected.rbegin(); iter != affected.rend(); ++iter) // stop the deepest dependents first
+    data.emplace(false, iter->second);
+
+  affected.emplace(depth_of(provider), provider); // the failed provider is already stopped
+
+  for(const auto& pair : affected) // start from the shallowest provider outward
+    data.emplace(true, pair.second);
+
+  return data; // return ordered list of providers to stop/start for this subgraph
+}
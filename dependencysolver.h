@@ -37,6 +37,8 @@ public:
 
   void resolveDependencies(void) noexcept;
   runlevel_actions_t getRunlevelOrder(const std::string& runlevel) const noexcept;
+  runlevel_actions_t getRestartOrder(const std::string& provider, const std::set<std::string>& active_providers) const noexcept;
+  std::set<std::string> getDependents(const std::string& provider) const noexcept;
 
   virtual const std::string& getConfigValue(const std::string& config, const std::string& key) const noexcept = 0;
   virtual std::list<std::string> getConfigList(void) const noexcept = 0;
@@ -71,6 +73,9 @@ private:
   std::map<runlevel_t, runlevelorder_t> m_orders_start; // the provider starting order by runlevel number
   std::map<runlevel_t, runlevelorder_t> m_orders_stop; // the provider stopping order by runlevel number
 
+  std::map<std::string, std::set<std::string>> m_dependents; // providers that actively depend on a provider (reverse edges)
+  std::map<std::string, depth_t> m_provider_depths; // dependency depth by provider name
+
   depth_t dependency_depth(depnodeptr origin, depinfo_t<depnodeptr> dependency, depinfoset_t<depnodeptr> path, bool is_required) noexcept;
   bool recurse_add(runlevelorder_t& subset, depnodeptr dependency, bool activate) const noexcept;
 };
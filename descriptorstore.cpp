@@ -0,0 +1,169 @@
+#include "descriptorstore.h"
+
+// PUT
+#include <put/object.h>
+#include <put/cxxutils/hashing.h>
+#include <put/cxxutils/syslogstream.h>
+
+// POSIX
+#include <fcntl.h>
+
+#ifndef SCFS_PATH
+#define SCFS_PATH               "/svc"
+#endif
+
+DescriptorStore::DescriptorStore(provider_lookup_t lookup) noexcept
+  : m_lookup(lookup),
+    m_retry(0),
+    m_warned(false)
+{
+  Object::connect(newPeerRequest, this, &DescriptorStore::request);
+  Object::connect(newPeerMessage, this, &DescriptorStore::receive);
+  Object::connect(disconnectedPeer, this, &DescriptorStore::disconnected);
+  listen();
+}
+
+DescriptorStore::~DescriptorStore(void) noexcept
+{
+  if(m_retry)
+    TimerWheel::instance().cancel(m_retry);
+  for(auto& provider : m_store)
+    for(auto& pair : provider.second)
+      posix::close(pair.second);
+}
+
+void DescriptorStore::listen(void) noexcept
+{
+  m_retry = 0;
+  if(bind(SCFS_PATH DIRECTOR_FDSTORE_SOCKET))
+    return;
+
+  if(!m_warned) // once: it is expected while SCFS is not mounted
+    posix::syslog << posix::priority::warning
+                  << "Unable to bind descriptor store to socket file %1 : %2"
+                  << SCFS_PATH DIRECTOR_FDSTORE_SOCKET
+                  << posix::strerror(errno)
+                  << posix::eom;
+  m_warned = true;
+  m_retry = TimerWheel::instance().schedule(DIRECTOR_FDSTORE_RETRY, [this]() noexcept { listen(); });
+}
+
+void DescriptorStore::handOff(void) noexcept
+{
+  for(auto& provider : m_store)
+    for(auto& pair : provider.second)
+      ::fcntl(pair.second, F_SETFD, 0); // survive exec()
+}
+
+void DescriptorStore::adopt(const std::string& provider, const std::string& name, posix::fd_t fd) noexcept
+{
+  if(::fcntl(fd, F_SETFD, FD_CLOEXEC) == posix::error_response) // not open: the old image did not hand it off
+    return;
+  std::unordered_map<std::string, posix::fd_t>& descriptors = m_store[provider];
+  auto iter = descriptors.find(name);
+  if(iter != descriptors.end() && iter->second != fd)
+    posix::close(iter->second);
+  descriptors[name] = fd;
+}
+
+void DescriptorStore::release(const std::string& provider) noexcept
+{
+  auto iter = m_store.find(provider);
+  if(iter != m_store.end())
+  {
+    for(auto& pair : iter->second)
+      posix::close(pair.second);
+    m_store.erase(iter);
+  }
+}
+
+// only processes belonging to a managed provider may use the store
+void DescriptorStore::request(posix::fd_t socket, posix::sockaddr_t addr, proccred_t cred) noexcept
+{
+  (void)addr;
+  std::string provider = m_lookup(cred.pid);
+  if(provider.empty())
+    rejectPeerRequest(socket);
+  else if(acceptPeerRequest(socket))
+    m_peers[socket] = provider;
+}
+
+void DescriptorStore::disconnected(posix::fd_t socket) noexcept
+{
+  m_peers.erase(socket);
+}
+
+void DescriptorStore::receive(posix::fd_t socket, vfifo buffer, posix::fd_t fd) noexcept
+{
+  std::string str, name;
+  auto peer = m_peers.find(socket);
+  if(peer == m_peers.end()) // unknown peer
+  {
+    if(fd != posix::invalid_descriptor)
+      posix::close(fd);
+    return;
+  }
+
+  auto provider = m_store.find(peer->second); // only storing creates an entry
+
+  if(!(buffer >> str).hadError() && str == "RPC" &&
+     !(buffer >> str).hadError())
+  {
+    switch(hash(str))
+    {
+      case "storeCall"_hash:
+      {
+        buffer >> name;
+        if(buffer.hadError() || fd == posix::invalid_descriptor)
+        {
+          write(socket, vfifo("RPC", "storeReturn", posix::error_t(posix::errc::invalid_argument), name), posix::invalid_descriptor);
+          break;
+        }
+        if(provider == m_store.end())
+          provider = m_store.emplace(peer->second, std::unordered_map<std::string, posix::fd_t>()).first;
+        std::unordered_map<std::string, posix::fd_t>& descriptors = provider->second;
+        auto iter = descriptors.find(name);
+        if(iter != descriptors.end()) // if replacing a stored descriptor
+          posix::close(iter->second);
+        else if(descriptors.size() >= DIRECTOR_FDSTORE_LIMIT) // one provider must not use up our descriptor table
+        {
+          write(socket, vfifo("RPC", "storeReturn", posix::error_t(posix::errc::too_many_files_open), name), posix::invalid_descriptor);
+          break;
+        }
+        ::fcntl(fd, F_SETFD, FD_CLOEXEC); // providers get it through the store only
+        descriptors[name] = fd;
+        fd = posix::invalid_descriptor; // now owned by the store
+        write(socket, vfifo("RPC", "storeReturn", posix::error_t(posix::success_response), name), posix::invalid_descriptor);
+      }
+      break;
+      case "retrieveCall"_hash:
+      {
+        buffer >> name;
+        if(buffer.hadError() || provider == m_store.end() || provider->second.find(name) == provider->second.end())
+          write(socket, vfifo("RPC", "retrieveReturn", posix::error_t(posix::errc::no_such_file_or_directory), name), posix::invalid_descriptor);
+        else // the store keeps its copy so every later restart can retrieve it too
+          write(socket, vfifo("RPC", "retrieveReturn", posix::error_t(posix::success_response), name), provider->second[name]);
+      }
+      break;
+      case "releaseCall"_hash:
+      {
+        buffer >> name;
+        if(buffer.hadError() || provider == m_store.end() || provider->second.find(name) == provider->second.end())
+          write(socket, vfifo("RPC", "releaseReturn", posix::error_t(posix::errc::no_such_file_or_directory), name), posix::invalid_descriptor);
+        else
+        {
+          auto iter = provider->second.find(name);
+          posix::close(iter->second);
+          provider->second.erase(iter);
+          if(provider->second.empty())
+            m_store.erase(provider);
+          write(socket, vfifo("RPC", "releaseReturn", posix::error_t(posix::success_response), name), posix::invalid_descriptor);
+        }
+      }
+      break;
+    }
+  }
+
+  if(fd != posix::invalid_descriptor) // descriptor was not stored
+    posix::close(fd);
+}
@@ -0,0 +1,63 @@
+#ifndef DESCRIPTORSTORE_H
+#define DESCRIPTORSTORE_H
+
+// STL
+#include <string>
+#include <unordered_map>
+#include <functional>
+
+// PUT
+#include <put/socket.h>
+#include <put/cxxutils/vfifo.h>
+#include <put/cxxutils/posix_helpers.h>
+
+// Director
+#include "timerwheel.h"
+
+#ifndef DIRECTOR_USERNAME
+#define DIRECTOR_USERNAME       "director"
+#endif
+
+#ifndef DIRECTOR_FDSTORE_SOCKET
+#define DIRECTOR_FDSTORE_SOCKET "/" DIRECTOR_USERNAME "/fdstore"
+#endif
+
+#ifndef DIRECTOR_FDSTORE_RETRY
+#define DIRECTOR_FDSTORE_RETRY  1000 // milliseconds between attempts to bind (SCFS may not be mounted yet)
+#endif
+
+#ifndef DIRECTOR_FDSTORE_LIMIT
+#define DIRECTOR_FDSTORE_LIMIT  64 // descriptors a single provider may store
+#endif
+
+// holds file descriptors for providers so they survive a provider restart
+class DescriptorStore : public ServerSocket
+{
+public:
+  typedef std::function<std::string(pid_t)> provider_lookup_t; // returns the provider name of a PID
+  typedef std::unordered_map<std::string, std::unordered_map<std::string, posix::fd_t>> store_t; // descriptors by provider and name
+
+  DescriptorStore(provider_lookup_t lookup) noexcept;
+  ~DescriptorStore(void) noexcept;
+
+  void release(const std::string& provider) noexcept; // close every descriptor held for a provider
+
+  // reloading the binary: the descriptors stay open across exec() and the new image adopts them
+  const store_t& descriptors(void) const noexcept { return m_store; }
+  void handOff(void) noexcept;
+  void adopt(const std::string& provider, const std::string& name, posix::fd_t fd) noexcept;
+
+private:
+  void listen(void) noexcept; // bind or try again later
+  void request(posix::fd_t socket, posix::sockaddr_t addr, proccred_t cred) noexcept;
+  void receive(posix::fd_t socket, vfifo buffer, posix::fd_t fd) noexcept;
+  void disconnected(posix::fd_t socket) noexcept;
+
+  provider_lookup_t m_lookup;
+  std::unordered_map<posix::fd_t, std::string> m_peers; // provider name by peer socket
+  store_t m_store;
+  TimerWheel::handle_t m_retry; // zero unless waiting to bind again
+  bool m_warned; // the bind failure was logged
+};
+
+#endif // DESCRIPTORSTORE_H
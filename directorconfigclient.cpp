@@ -9,12 +9,11 @@
 #include <put/cxxutils/hashing.h>
 #include <put/cxxutils/syslogstream.h>
 
-#ifndef SCFS_PATH
-#define SCFS_PATH               "/svc"
-#endif
+// Director
+#include "snapshot.h"
 
-#ifndef DIRECTOR_CONFIG_DIR
-#define DIRECTOR_CONFIG_DIR     "/etc/" DIRECTOR_USERNAME
+#ifndef DIRECTOR_CONFIG_COMPACT_MIN
+#define DIRECTOR_CONFIG_COMPACT_MIN  4096 // unreferenced strings tolerated before the pool is rebuilt
 #endif
 
 
@@ -23,71 +22,41 @@
 #define UNABLE_TO_READ_CONFIGURATION            0x11
 #define UNABLE_TO_PARSE_CONFIGURATION           0x12
 
-#ifndef NO_CONFIG_FALLBACK
-#include <dirent.h>
-#include <put/cxxutils/configmanip.h>
-
 
-static const char* extract_provider_name(const char* filename)
+DirectorConfigClient::DirectorConfigClient(const std::string& socket_path,
+                                           const std::string& image_path) noexcept
+  : m_socket_path(socket_path),
+    m_image_path(image_path),
+    m_sync(false),
+    m_generation(0),
+    m_server_instance(0),
+    m_unacknowledged(0),
+    m_pending_sync(sync_request_t::none),
+    m_fast_sync(true),
+    m_sync_timer(0),
+    m_image_generation(0),
+    m_image_instance(0),
+    m_in_transaction(false),
+    m_strings(std::make_shared<StringPool>()),
+    m_garbage(0)
 {
-  char provider[NAME_MAX] = { 0 };
-  const char* start = posix::strrchr(filename, '/');
-  const char* end   = posix::strrchr(filename, '.');
-
-  if(start == nullptr || // if '/' NOT found OR
-     end   == nullptr || // '.' found AND
-     end < start || // occur in the incorrect order OR
-     posix::strcmp(end, ".conf")) // doesn't end with ".conf"
-    return nullptr;
-  return posix::strncpy(provider, start + 1, posix::size_t(end - start + 1)); // extract provider name
+  Object::connect(newMessage, this, &DirectorConfigClient::receive);
+#ifndef NO_CONFIG_FALLBACK
+  Object::connect(m_watcher.filesChanged, this, &DirectorConfigClient::filesChanged);
+  Object::connect(m_watcher.overflowed  , this, &DirectorConfigClient::reloadFiles);
+#endif
+  Object::singleShot(this, &DirectorConfigClient::resync, errno = posix::success_response);
 }
 
-static const char* director_configfilename(const char* filename)
+DirectorConfigClient::~DirectorConfigClient(void) noexcept
 {
-  // construct config filename
-  static char fullpath[PATH_MAX];
-  posix::memset(fullpath, 0, PATH_MAX);
-  if(posix::snprintf(fullpath, PATH_MAX, "%s/%s", DIRECTOR_CONFIG_DIR, filename) == posix::error_response) // I don't how this could fail
-    return nullptr; // unable to build config filename
-  return fullpath;
+  if(m_sync_timer)
+    TimerWheel::instance().cancel(m_sync_timer);
 }
 
-static bool readconfig(const char* name, std::string& buffer)
+const ConfigTable& DirectorConfigClient::data(const std::string& config) const
 {
-  posix::FILE* file = posix::fopen(name, "rb");
-
-  if(file == nullptr)
-  {
-    posix::syslog << posix::priority::warning
-                  << "Unable to open file: %1 : %2"
-                  << name
-                  << posix::strerror(errno)
-                  << posix::eom;
-    return false;
-  }
-
-  buffer.clear();
-  buffer.resize(posix::size_t(posix::ftell(file)), '\n');
-  if(buffer.size())
-  {
-    posix::rewind(file);
-    posix::fread(const_cast<char*>(buffer.data()), sizeof(std::string::value_type), buffer.size(), file);
-  }
-  posix::fclose(file);
-  return true;
-}
-#endif
-
-DirectorConfigClient::DirectorConfigClient(void) noexcept
-  : m_sync(false)
-{
-  Object::connect(newMessage, this, &DirectorConfigClient::receive);
-  Object::singleShot(this, &DirectorConfigClient::resync, errno = posix::success_response);
-}
-
-const std::unordered_map<std::string, std::string>& DirectorConfigClient::data(const std::string& config) const
-{
-  static const std::unordered_map<std::string, std::string> nullval;
+  static const ConfigTable nullval;
   auto pos = m_data.find(config);
   if(pos == m_data.end())
     return nullval;
@@ -96,8 +65,8 @@ const std::unordered_map<std::string, std::string>& DirectorConfigClient::data(c
 
 void DirectorConfigClient::resync(posix::error_t errcode) noexcept
 {
-  m_data.clear();
   m_sync = false;
+  syncAnswered(); // nothing is waiting on the old connection
   if(isConnected())
     disconnect();
 
@@ -107,10 +76,26 @@ void DirectorConfigClient::resync(posix::error_t errcode) noexcept
     // connection counter stuff here
   }
 
+  if(m_unacknowledged || !m_transaction.empty() || // local changes may differ from the server data (a delta would keep them) OR
+     !m_fast_sync) // the server can only send everything
+    m_generation = 0;
+  m_unacknowledged = 0; // answers to earlier connections are lost
+
+  if(!m_generation) // if a delta can't be requested
+  {
+    clearData(); // start from nothing
+    m_changes.everything = true;
+    if(m_fast_sync) // a delta can be requested from the saved image
+      loadServerImage(); // unless the last sync was saved
+  }
+
   if(try_connecting &&
-     connect(SCFS_PATH CONFIG_DIRECTOR_SOCKET) &&
-     write(vfifo("RPC", "syncCall"), posix::invalid_descriptor)) // no errors!
+     connect(m_socket_path.c_str()) &&
+     requestSync()) // no errors!
   {
+#ifndef NO_CONFIG_FALLBACK
+    m_watcher.unwatch(); // the server is authoritative again
+#endif
   }
   else
   {
@@ -119,12 +104,12 @@ void DirectorConfigClient::resync(posix::error_t errcode) noexcept
       if(!isConnected())
         posix::syslog << posix::priority::warning
                       << "Unable to connect to socket file %1"
-                      << SCFS_PATH CONFIG_DIRECTOR_SOCKET
+                      << m_socket_path
                       << posix::eom;
       else
         posix::syslog << posix::priority::warning
                       << "Connection error for socket file %1 : %2"
-                      << SCFS_PATH CONFIG_DIRECTOR_SOCKET
+                      << m_socket_path
                       << posix::strerror(errno)
                       << posix::eom;
     }
@@ -135,11 +120,11 @@ void DirectorConfigClient::resync(posix::error_t errcode) noexcept
                   << "Continuing without configuration provider connection for Director.  Falling back on direct file access."
                   << posix::eom;
 
-    DIR* dir = ::opendir(DIRECTOR_CONFIG_DIR);
-    dirent* entry = nullptr;
-    const char* provider = nullptr;
-    const char* filename = nullptr;
-    if(dir == nullptr)
+    clearData(); // file data has no generation
+    m_generation = 0;
+    m_changes.everything = true;
+
+    if(!loadFiles())
     {
       posix::syslog << posix::priority::critical
                     << "Unable to read directory of Director configuation files: %1"
@@ -148,59 +133,341 @@ void DirectorConfigClient::resync(posix::error_t errcode) noexcept
     }
     else
     {
-      std::string buffer;
-      ConfigManip tmp_config;
+      if(!m_watcher.isWatching() && !m_watcher.watch(DIRECTOR_CONFIG_DIR))
+        posix::syslog << posix::priority::warning
+                      << "Unable to watch %1 for changes.  Edits will be ignored until a resync."
+                      << DIRECTOR_CONFIG_DIR
+                      << posix::eom;
+      m_sync = true;
+      Object::enqueue(synchronized);
+    }
+#endif
+  }
+}
 
-      while((entry = ::readdir(dir)) != nullptr)
-      {
-        if(entry->d_name[0] == '.') // skip dot files/dirs
-          continue;
+// the local data may hold changes the server never applied: request everything
+void DirectorConfigClient::fullResync(posix::error_t errcode) noexcept
+{
+  m_generation = 0;
+  resync(errcode);
+}
 
-        if((provider = extract_provider_name  (entry->d_name)) == nullptr || // if provider name extraction failed OR
-           (filename = director_configfilename(entry->d_name)) == nullptr) // failed to build filename
-          continue; // skip file
+// only what changed or everything at once when the server can, otherwise everything streamed (every server can)
+bool DirectorConfigClient::requestSync(void) noexcept
+{
+  if(!m_fast_sync)
+  {
+    m_pending_sync = sync_request_t::full;
+    return write(vfifo("RPC", "syncCall"), posix::invalid_descriptor);
+  }
 
-        tmp_config.clear();
-        if(!readconfig(filename, buffer))
-        {
-          posix::syslog << posix::priority::critical
-                        << "Unable to read Director configuation file: %1 : %2"
-                        << filename
-                        << posix::strerror(errno)
-                        << posix::eom;
-        }
-        else if(!tmp_config.importText(buffer))
-        {
-          posix::syslog << posix::priority::critical
-                        << "Parsing failed will processing Director configuation file: %1"
-                        << filename
-                        << posix::eom;
-        }
+  if(m_generation && m_server_instance) // a generation only means something to the server that numbered it
+  {
+    m_pending_sync = sync_request_t::delta;
+    if(!write(vfifo("RPC", "syncDeltaCall", m_server_instance, m_generation), posix::invalid_descriptor))
+      return false;
+  }
+  else
+  {
+    m_pending_sync = sync_request_t::snapshot;
+    if(!write(vfifo("RPC", "syncSnapshotCall"), posix::invalid_descriptor))
+      return false;
+  }
+  m_sync_timer = TimerWheel::instance().schedule(CONFIG_SYNC_TIMEOUT, [this]() noexcept { syncTimedOut(); });
+  return true;
+}
 
-        tmp_config.exportKeyPairs(m_data[provider]);
-      }
-      m_sync = true;
-      Object::enqueue(synchronized);
+void DirectorConfigClient::requestFullSync(void) noexcept
+{
+  clearData();
+  m_generation = 0;
+  m_changes.everything = true;
+  m_pending_sync = sync_request_t::full;
+  if(!write(vfifo("RPC", "syncCall"), posix::invalid_descriptor))
+    Object::singleShot(this, &DirectorConfigClient::resync, errno);
+}
+
+void DirectorConfigClient::syncAnswered(void) noexcept
+{
+  if(m_sync_timer)
+    TimerWheel::instance().cancel(m_sync_timer);
+  m_sync_timer = 0;
+  m_pending_sync = sync_request_t::none;
+}
+
+// servers that predate snapshots and deltas ignore the request
+void DirectorConfigClient::syncTimedOut(void) noexcept
+{
+  m_sync_timer = 0; // has fired
+  posix::syslog << posix::priority::notice
+                << "No answer to a snapshot or delta request from %1.  Requesting full syncs instead."
+                << m_socket_path
+                << posix::eom;
+  m_fast_sync = false;
+  requestFullSync();
+}
+
+// start from the image of the last server sync so that only the changes since then are requested
+void DirectorConfigClient::loadServerImage(void) noexcept
+{
+  ConfigImage image;
+  if(image.open(m_image_path.c_str()) &&
+     image.generation() && image.serverInstance() && // the image holds server data AND
+     image.epoch() && image.epoch() == config_image_epoch()) // generations were not restarted by a reboot
+  {
+    replaceData(image);
+    m_generation = m_image_generation = image.generation();
+    m_server_instance = m_image_instance = image.serverInstance(); // a restarted server answers the delta request with a full sync
+  }
+}
+
+// save the synchronized server data for the next start
+void DirectorConfigClient::storeServerImage(void) noexcept
+{
+  if(m_generation && m_server_instance &&
+     (m_generation != m_image_generation || m_server_instance != m_image_instance) && // if the image is out of date AND
+     !m_unacknowledged) // holds nothing but server data
+  {
+    config_image_stamp_t stamp = { 0, 0, 0, 0, 0 }; // server data has no source files
+    if(write_config_image(m_image_path.c_str(), m_generation, m_server_instance, config_image_epoch(), stamp, exportData()))
+    {
+      m_image_generation = m_generation;
+      m_image_instance = m_server_instance;
     }
+  }
+}
+
+#ifndef NO_CONFIG_FALLBACK
+// use the compiled image unless a source file is newer, otherwise parse the files and recompile the image
+bool DirectorConfigClient::loadFiles(void) noexcept
+{
+  config_image_stamp_t source_stamp;
+  std::unordered_map<std::string, configmap_t> configs;
+  bool have_stamp = config_source_stamp(DIRECTOR_CONFIG_DIR, source_stamp);
+
+  ConfigImage image;
+  if(have_stamp &&
+     image.open(m_image_path.c_str()) &&
+     !image.generation() && // image was compiled from files AND
+     image.stamp() == source_stamp) // the files are unchanged
+  {
+    replaceData(image);
+    return true;
+  }
+  image.close();
+
+  if(!m_loader.load(DIRECTOR_CONFIG_DIR, configs))
+    return false;
+  replaceData(configs);
+
+  m_image_generation = 0;
+  m_image_instance = 0;
+  if(have_stamp && !write_config_image(m_image_path.c_str(), 0, 0, 0, source_stamp, configs))
+    posix::syslog << posix::priority::notice
+                  << "Unable to write configuration image %1 : %2"
+                  << m_image_path
+                  << posix::strerror(errno)
+                  << posix::eom;
+  return true;
+}
+
+// re-import only the edited files
+void DirectorConfigClient::filesChanged(std::set<std::string> filenames) noexcept
+{
+  if(isConnected()) // the server is authoritative
+    return;
+
+  std::string provider;
+  configmap_t file_data;
+  for(const std::string& filename : filenames)
+    if(m_loader.loadFile(DIRECTOR_CONFIG_DIR, filename, provider, file_data))
+      applyFileData(provider, file_data);
+
+  if(!m_changes.empty())
+    Object::enqueue(updated);
+}
+
+// events were lost: compare every file (unchanged files are not parsed again)
+void DirectorConfigClient::reloadFiles(void) noexcept
+{
+  std::unordered_map<std::string, configmap_t> configs;
+  if(isConnected() || // if the server is authoritative OR
+     !m_loader.load(DIRECTOR_CONFIG_DIR, configs)) // unable to read the directory
+    return;
+
+  for(const std::string& config : listConfigs())
+    if(configs.find(config) == configs.end()) // file is gone
+      applyFileData(config, configmap_t());
+  for(const auto& pair : configs)
+    applyFileData(pair.first, pair.second);
+
+  if(!m_changes.empty())
+    Object::enqueue(updated);
+}
+
+// bring a config in line with its file through the same paths that server updates use
+void DirectorConfigClient::applyFileData(const std::string& config, const configmap_t& file_data) noexcept
+{
+  const ConfigTable current = data(config); // copy (shares the strings) because it is modified below
+  for(const auto& pair : current)
+    if(file_data.find(pair.first) == file_data.end())
+      valueUnset(config, pair.first);
+
+  for(const auto& pair : file_data)
+  {
+    const ConfigTable& config_data = data(config); // unsetting may have removed the config
+    auto iter = config_data.find(pair.first);
+    if(iter == config_data.end() || iter->second != pair.second)
+      valueSet(config, pair.first, pair.second);
+  }
+}
 #endif
+
+// callers re-read data after taking changes, which makes this a safe point to rebuild the pool
+changeset_t DirectorConfigClient::takeChanges(void) noexcept
+{
+  if(m_garbage > DIRECTOR_CONFIG_COMPACT_MIN &&
+     m_garbage * 2 > m_strings->size()) // if most pooled strings may be unreferenced
+    compact();
+  if(!m_changes.empty())
+    publish();
+
+  changeset_t changes;
+  std::swap(changes, m_changes);
+  return changes;
+}
+
+void DirectorConfigClient::clearData(void) noexcept
+{
+  m_data.clear();
+  m_strings = std::make_shared<StringPool>();
+  m_garbage = 0;
+}
+
+void DirectorConfigClient::replaceData(const std::unordered_map<std::string, configmap_t>& configs) noexcept
+{
+  clearData();
+  for(const auto& pair : configs)
+  {
+    ConfigTable& table = m_data.emplace(pair.first, ConfigTable(m_strings)).first->second;
+    for(const auto& entry : pair.second) // ordered by key: each entry is appended
+      table.set(entry.first, entry.second);
+  }
+}
+
+// the tables are built straight from the image records, each image string is copied into the pool once
+void DirectorConfigClient::replaceData(const ConfigImage& image) noexcept
+{
+  clearData();
+  std::vector<strid_t> ids;
+  m_data.reserve(image.providerCount());
+  for(uint32_t provider = 0; provider < image.providerCount(); ++provider)
+    m_data.emplace(image.providerName(provider), image.table(provider, m_strings, ids));
+}
+
+std::unordered_map<std::string, configmap_t> DirectorConfigClient::exportData(void) const noexcept
+{
+  std::unordered_map<std::string, configmap_t> configs;
+  for(const auto& pair : m_data)
+    configs.emplace(pair.first, pair.second.toMap());
+  return configs;
+}
+
+// move the strings that are still referenced into a new pool
+void DirectorConfigClient::compact(void) noexcept
+{
+  std::shared_ptr<StringPool> strings = std::make_shared<StringPool>();
+  for(auto& pair : m_data)
+    pair.second.rebind(strings);
+  m_strings = strings;
+  m_garbage = 0;
+}
+
+// copy the changed configs into strings of their own, share the tables of the others
+void DirectorConfigClient::publish(void) noexcept
+{
+  director_config_view_t previous = m_published.load();
+  std::shared_ptr<director_config_snapshot_t> next = std::make_shared<director_config_snapshot_t>();
+  std::shared_ptr<StringPool> strings; // for the changed configs
+  next->generation = m_generation;
+  next->configs.reserve(m_data.size());
+  for(const auto& pair : m_data)
+  {
+    auto old = previous->configs.find(pair.first);
+    if(!m_changes.everything &&
+       old != previous->configs.end() &&
+       m_changes.keys.find(pair.first) == m_changes.keys.end()) // if the config is unchanged
+      next->configs.emplace(pair.first, old->second);
+    else
+    {
+      if(!strings)
+        strings = std::make_shared<StringPool>();
+      ConfigTable table = pair.second;
+      table.rebind(strings); // the live pool keeps changing
+      next->configs.emplace(pair.first, std::move(table));
+    }
+  }
+  m_published.store(next);
+}
+
+std::list<DirectorConfigClient::memory_report_t> DirectorConfigClient::memoryReport(size_t& pool_bytes) const noexcept
+{
+  std::list<memory_report_t> report;
+  for(const auto& pair : m_data)
+    report.push_back({ pair.first, pair.second.size(), pair.second.mapBytes(), pair.second.tableBytes() });
+  pool_bytes = m_strings->bytes();
+  return report;
+}
+
+void DirectorConfigClient::logMemoryReport(void) const noexcept
+{
+  size_t pool_bytes = 0;
+  size_t map_total = 0;
+  size_t table_total = 0;
+  for(const memory_report_t& entry : memoryReport(pool_bytes))
+  {
+    posix::syslog << posix::priority::debug
+                  << "Config %1: %2 entries, %3 bytes as maps, %4 bytes as tables"
+                  << entry.config
+                  << std::to_string(entry.entries)
+                  << std::to_string(entry.map_bytes)
+                  << std::to_string(entry.table_bytes)
+                  << posix::eom;
+    map_total += entry.map_bytes;
+    table_total += entry.table_bytes;
   }
+  posix::syslog << posix::priority::debug
+                << "Config storage: %1 bytes as maps, %2 bytes as tables plus %3 bytes of shared strings"
+                << std::to_string(map_total)
+                << std::to_string(table_total)
+                << std::to_string(pool_bytes)
+                << posix::eom;
 }
 
-void DirectorConfigClient::valueSet(const std::string& config, const std::string& key, const std::string& value) noexcept
-  { m_data[config][key] = value; }
+void DirectorConfigClient::valueSet(const std::string& config, std::string key, std::string value) noexcept
+{
+  auto configdata = m_data.find(config);
+  if(configdata == m_data.end()) // new config
+  {
+    configdata = m_data.emplace(config, ConfigTable(m_strings)).first;
+    m_changes.configs_changed = true;
+  }
+  m_changes.add(config, key);
+  if(configdata->second.set(std::move(key), std::move(value))) // if a value was replaced
+    ++m_garbage;
+}
 
 void DirectorConfigClient::valueUnset(const std::string& config, const std::string& key) noexcept
 {
   auto configdata = m_data.find(config);
   if(configdata != m_data.end())
   {
-    auto pos = configdata->second.begin();
-    while(pos != configdata->second.end()) // search for key or children
+    m_changes.add(config, key);
+    m_garbage += configdata->second.erasePrefix(key); // delete key and children
+    if(configdata->second.empty()) // config no longer has any data
     {
-      if(pos->first.find(key) == 0) // key starts with search key (could be a child)
-        pos = configdata->second.erase(pos); // delete it
-      else
-        ++pos;
+      m_data.erase(configdata);
+      m_changes.configs_changed = true;
     }
   }
 }
@@ -222,27 +489,69 @@ const std::string& DirectorConfigClient::get(const std::string& config, const st
   auto keydata = configdata->second.find(key);
   if(keydata == configdata->second.end())
     return nullvalue;
-  return keydata->second;
+  return (*keydata).second; // refers to the pooled string
 }
 
 void DirectorConfigClient::set(const std::string& config, const std::string& key, const std::string& value) noexcept
 {
   valueSet(config, key, value);
-  if(isConnected() && !write(vfifo("RPC", "setCall", config, key, value), posix::invalid_descriptor))
-    Object::singleShot(this, &DirectorConfigClient::resync, errno);
+  if(m_in_transaction)
+    m_transaction.push_back({ true, config, key, value });
+  else if(isConnected())
+  {
+    if(write(vfifo("RPC", "setCall", config, key, value), posix::invalid_descriptor))
+      ++m_unacknowledged; // resynchronized in full if it is never answered
+    else
+      Object::singleShot(this, &DirectorConfigClient::fullResync, errno);
+  }
 }
 
 void DirectorConfigClient::unset(const std::string& config, const std::string& key) noexcept
 {
   valueUnset(config, key);
-  if(isConnected() && !write(vfifo("RPC", "unsetCall", config, key), posix::invalid_descriptor))
-    Object::singleShot(this, &DirectorConfigClient::resync, errno);
+  if(m_in_transaction)
+    m_transaction.push_back({ false, config, key, std::string() });
+  else if(isConnected())
+  {
+    if(write(vfifo("RPC", "unsetCall", config, key), posix::invalid_descriptor))
+      ++m_unacknowledged; // resynchronized in full if it is never answered
+    else
+      Object::singleShot(this, &DirectorConfigClient::fullResync, errno);
+  }
+}
+
+void DirectorConfigClient::begin(void) noexcept
+{
+  m_in_transaction = true;
+}
+
+bool DirectorConfigClient::commit(void) noexcept
+{
+  m_in_transaction = false;
+  if(m_transaction.empty())
+    return true;
+
+  vfifo buffer;
+  buffer << "RPC" << "batchCall" << uint32_t(m_transaction.size());
+  for(const change_t& change : m_transaction)
+    buffer << (change.is_set ? "set" : "unset") << change.config << change.key << change.value;
+  m_transaction.clear();
+
+  if(isConnected())
+  {
+    if(!write(buffer, posix::invalid_descriptor))
+    {
+      Object::singleShot(this, &DirectorConfigClient::fullResync, errno);
+      return false;
+    }
+    ++m_unacknowledged;
+  }
+  return true;
 }
 
 void DirectorConfigClient::receive(posix::fd_t socket, vfifo buffer, posix::fd_t fd) noexcept
 {
   (void)socket;
-  (void)fd;
   posix::error_t errcode;
   std::string str, config, key, value;
   if(!(buffer >> str).hadError() && str == "RPC" &&
@@ -252,48 +561,143 @@ void DirectorConfigClient::receive(posix::fd_t socket, vfifo buffer, posix::fd_t
     {
       case "syncReturn"_hash:
       {
+        if(m_pending_sync != sync_request_t::full) // not asked for on this connection
+          break;
+        syncAnswered();
         buffer >> errcode;
         if(buffer.hadError() || errcode != posix::success_response)
-          Object::singleShot(this, &DirectorConfigClient::resync, errcode);
+          Object::singleShot(this, &DirectorConfigClient::fullResync, errcode);
         else if(errcode == posix::success_response)
+        {
+          if((buffer >> m_server_instance >> m_generation).hadError()) // if the server does not version its data
+            m_server_instance = m_generation = 0;
+          m_sync = true;
+          storeServerImage();
+          Object::enqueue(synchronized);
+        }
+      }
+      break;
+      case "syncSnapshotReturn"_hash:
+      {
+        uint32_t entry_count = 0;
+        ConfigTable* table = nullptr; // entries are grouped by config
+        std::string table_name;
+        if(m_pending_sync != sync_request_t::snapshot) // answered after giving up on it
+        {
+          m_fast_sync = true; // the server is slow, not old
+          break;
+        }
+        syncAnswered();
+        buffer >> errcode >> m_server_instance >> m_generation;
+        clearData();
+        m_changes.everything = true;
+        if(!buffer.hadError() &&
+           errcode == posix::success_response &&
+           read_snapshot(fd, DIRECTOR_CONFIG_SNAPSHOT_MAGIC, 3, entry_count,
+                         [this, &table, &table_name](const snapshot_field_t* fields) noexcept
+                           {
+                             if(table == nullptr || // if first entry OR
+                                table_name.size() != fields[0].size || // different config
+                                posix::memcmp(table_name.data(), fields[0].data, fields[0].size))
+                             {
+                               table_name.assign(fields[0].data, fields[0].size);
+                               table = &m_data.emplace(table_name, ConfigTable(m_strings)).first->second;
+                             }
+                             table->set(std::string(fields[1].data, fields[1].size),
+                                        std::string(fields[2].data, fields[2].size));
+                           })) // the whole configuration was read from the snapshot
+        {
+          m_sync = true;
+          storeServerImage();
+          Object::enqueue(synchronized);
+        }
+        else // no usable snapshot: fall back to a streamed full sync
+        {
+          requestFullSync();
+        }
+      }
+      break;
+      case "syncDeltaReturn"_hash:
+      {
+        if(m_pending_sync != sync_request_t::delta) // answered after giving up on it
+        {
+          m_fast_sync = true; // the server is slow, not old
+          break;
+        }
+        syncAnswered();
+        uint64_t instance = 0;
+        buffer >> errcode >> instance >> m_generation;
+        if(!buffer.hadError() && errcode == posix::success_response &&
+           instance == m_server_instance) // changes since our generation have been applied by the same server
         {
           m_sync = true;
+          storeServerImage();
           Object::enqueue(synchronized);
         }
+        else // the server cannot serve the delta: fall back to a full sync
+        {
+          requestFullSync();
+        }
+      }
+      break;
+      case "generation"_hash: // follows every change set the server applies
+      {
+        uint64_t instance = 0;
+        buffer >> instance >> m_generation;
+        if(buffer.hadError() || instance != m_server_instance)
+          m_generation = 0; // can no longer trust the generation
+        if(m_sync)
+          Object::enqueue(updated); // one notification per change set
+      }
+      break;
+      case "batchReturn"_hash:
+      {
+        uint32_t count = 0;
+        if(m_unacknowledged)
+          --m_unacknowledged;
+        buffer >> errcode >> count;
+        if(buffer.hadError() || errcode != posix::success_response) // the batch was rejected: our data holds it
+          Object::singleShot(this, &DirectorConfigClient::fullResync, errcode);
       }
       break;
       case "valueSet"_hash:
       {
         buffer >> config >> key >> value;
         if(buffer.hadError())
-          Object::singleShot(this, &DirectorConfigClient::resync, errcode);
+          Object::singleShot(this, &DirectorConfigClient::fullResync, errcode);
         else
-          valueSet(config, key, value);
+          valueSet(config, std::move(key), std::move(value));
       }
       break;
       case "valueUnset"_hash:
       {
         buffer >> config >> key;
         if(buffer.hadError())
-          Object::singleShot(this, &DirectorConfigClient::resync, errcode);
+          Object::singleShot(this, &DirectorConfigClient::fullResync, errcode);
         else
           valueUnset(config, key);
       }
       break;
       case "unsetReturn"_hash:
       {
+        if(m_unacknowledged)
+          --m_unacknowledged;
         buffer >> errcode >> config >> key;
         if(buffer.hadError() || errcode != posix::success_response)
-          Object::singleShot(this, &DirectorConfigClient::resync, errcode);
+          Object::singleShot(this, &DirectorConfigClient::fullResync, errcode);
       }
       break;
       case "setReturn"_hash:
       {
+        if(m_unacknowledged)
+          --m_unacknowledged;
         buffer >> errcode >> config >> key;
         if(buffer.hadError() || errcode != posix::success_response)
-          Object::singleShot(this, &DirectorConfigClient::resync, errcode);
+          Object::singleShot(this, &DirectorConfigClient::fullResync, errcode);
       }
       break;
     }
   }
+  if(fd != posix::invalid_descriptor) // no passed descriptor is kept
+    posix::close(fd);
 }
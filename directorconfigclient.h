@@ -4,13 +4,32 @@
 // STL
 #include <atomic>
 #include <vector>
+#include <list>
 #include <string>
+#include <memory>
 
 // PUT
 #include <put/socket.h>
 #include <put/cxxutils/vfifo.h>
 #include <put/cxxutils/posix_helpers.h>
 
+// Director
+#include "changeset.h"
+#include "configmap.h"
+#include "configtable.h"
+#include "configsnapshot.h"
+#include "configimage.h"
+#include "timerwheel.h"
+
+#ifndef NO_CONFIG_FALLBACK
+#include "configloader.h"
+#include "configwatcher.h"
+#endif
+
+#ifndef SCFS_PATH
+#define SCFS_PATH               "/svc"
+#endif
+
 #ifndef DIRECTOR_USERNAME
 #define DIRECTOR_USERNAME       "director"
 #endif
@@ -19,6 +38,18 @@
 #define CONFIG_USERNAME         "config"
 #endif
 
+#ifndef DIRECTOR_CONFIG_DIR
+#define DIRECTOR_CONFIG_DIR     "/etc/" DIRECTOR_USERNAME
+#endif
+
+#ifndef DIRECTOR_CACHE_DIR
+#define DIRECTOR_CACHE_DIR      "/var/cache/" DIRECTOR_USERNAME
+#endif
+
+#ifndef DIRECTOR_CONFIG_IMAGE
+#define DIRECTOR_CONFIG_IMAGE   DIRECTOR_CACHE_DIR "/config.image"
+#endif
+
 #ifndef CONFIG_DIRECTOR_SOCKET
 #define CONFIG_DIRECTOR_SOCKET      "/" CONFIG_USERNAME "/" DIRECTOR_USERNAME
 #endif
@@ -27,25 +58,91 @@
 class DirectorConfigClient : public ClientSocket
 {
 public:
-  DirectorConfigClient(void) noexcept;
+  DirectorConfigClient(const std::string& socket_path = SCFS_PATH CONFIG_DIRECTOR_SOCKET,
+                       const std::string& image_path = DIRECTOR_CONFIG_IMAGE) noexcept;
+  ~DirectorConfigClient(void) noexcept;
 
   std::list<std::string> listConfigs(void) const noexcept;
   const std::string& get(const std::string& config, const std::string& key) const noexcept;
   void set  (const std::string& config, const std::string& key, const std::string& value) noexcept;
   void unset(const std::string& config, const std::string& key) noexcept;
 
+  void begin (void) noexcept; // collect set/unset calls until commit()
+  bool commit(void) noexcept; // apply collected calls atomically in one round trip
+
   bool isSynchronized(void) const noexcept { return m_sync; }
   signal<> synchronized;
+  signal<> updated; // the server applied a set of changes
+
+  changeset_t takeChanges(void) noexcept; // changes since the last call (publishes a new snapshot)
+  director_config_view_t snapshot(void) const noexcept { return m_published.load(); } // data as of the last takeChanges() // changes since the last call
 
-  const std::unordered_map<std::string, std::string>& data(const std::string& config) const;
+  const ConfigTable& data(const std::string& config) const;
+
+  struct memory_report_t
+  {
+    std::string config;
+    size_t entries;
+    size_t map_bytes; // estimate for the same data stored as a configmap_t
+    size_t table_bytes; // actual table (shared strings excluded)
+  };
+  std::list<memory_report_t> memoryReport(size_t& pool_bytes) const noexcept;
+  void logMemoryReport(void) const noexcept;
 private:
+  void clearData(void) noexcept; // start a new string pool generation
+  void replaceData(const std::unordered_map<std::string, configmap_t>& configs) noexcept;
+  void replaceData(const ConfigImage& image) noexcept;
+  std::unordered_map<std::string, configmap_t> exportData(void) const noexcept;
+  void compact(void) noexcept;
+  void publish(void) noexcept;
   void resync(posix::error_t errcode) noexcept;
+  void fullResync(posix::error_t errcode) noexcept; // after an error: local data can't be trusted
+  bool requestSync(void) noexcept;
+  void requestFullSync(void) noexcept;
+  void syncAnswered(void) noexcept;
+  void syncTimedOut(void) noexcept;
   void receive(posix::fd_t socket, vfifo buffer, posix::fd_t fd) noexcept;
-  void valueSet(const std::string& config, const std::string& key, const std::string& value) noexcept;
+  void valueSet(const std::string& config, std::string key, std::string value) noexcept; // by value: received strings are moved into storage
   void valueUnset(const std::string& config, const std::string& key) noexcept;
+  void loadServerImage(void) noexcept;
+  void storeServerImage(void) noexcept;
+#ifndef NO_CONFIG_FALLBACK
+  bool loadFiles(void) noexcept;
+  void filesChanged(std::set<std::string> filenames) noexcept;
+  void reloadFiles(void) noexcept;
+  void applyFileData(const std::string& config, const configmap_t& file_data) noexcept;
+#endif
 
-  std::unordered_map<std::string, std::unordered_map<std::string, std::string>> m_data;
+  std::unordered_map<std::string, ConfigTable> m_data;
+  struct change_t
+  {
+    bool is_set;
+    std::string config;
+    std::string key;
+    std::string value;
+  };
+
+  std::string m_socket_path;
+  std::string m_image_path; // last synchronized server data
   std::atomic_bool m_sync;
+  uint64_t m_generation; // server data generation, zero when unknown
+  uint64_t m_server_instance; // server process the generation belongs to (generations restart with it), zero when unknown
+  uint32_t m_unacknowledged; // local changes sent that the server has not answered yet
+  sync_request_t m_pending_sync;
+  bool m_fast_sync; // the server answers snapshot and delta requests (assumed until one goes unanswered)
+  TimerWheel::handle_t m_sync_timer;
+  uint64_t m_image_generation; // server data generation stored in the image
+  uint64_t m_image_instance; // and the server it belongs to
+  bool m_in_transaction;
+  std::list<change_t> m_transaction;
+  changeset_t m_changes;
+  std::shared_ptr<StringPool> m_strings; // strings of every table of this generation
+  size_t m_garbage; // pooled strings that may no longer be referenced
+  PublishedSnapshot<director_config_snapshot_t> m_published;
+#ifndef NO_CONFIG_FALLBACK
+  ConfigDirectoryLoader m_loader; // reuses unchanged files between fallback loads
+  ConfigWatcher m_watcher; // reports edits while in fallback mode
+#endif
 };
 
 #endif
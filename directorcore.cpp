@@ -18,18 +18,34 @@
 // Director
 #include "string_helpers.h"
 #include "servicecheck.h"
+#include "workerpool.h"
+#include "userdatabase.h"
 
 static_assert(sizeof(posix::size_t) == sizeof(std::unordered_map<int, int>::size_type), "bad size");
 static_assert(sizeof(posix::size_t) == sizeof(std::list<int>::size_type), "bad size");
 
 DirectorCore::DirectorCore(uid_t euid, gid_t egid, posix::fd_t shmid) noexcept
-  : m_euid(euid), m_egid(egid)
+  : m_restarting(false),
+    m_descriptor_store([this](pid_t pid) noexcept { return providerOfPid(pid); }),
+    m_reload_timer(0),
+    m_config_view(m_config_client.snapshot()),
+    m_director_view(m_director_config_client.snapshot()),
+    m_euid(euid), m_egid(egid)
 {
-  if(!shmLoad(shmid)) // if loading from shared memory failed
-    buildProcessMap(); // rebuild the process map from scratch
+  m_scan_pending = !shmLoad(shmid); // if loading from shared memory failed, rebuild the process map once the configs are known
+  m_scanning = false;
 
+  m_config_client.subscribe({ "/Runlevels/", "/Settings/" }); // ignore keys of other daemons
   Object::connect(m_config_client.synchronized, this, &DirectorCore::multiSyncReloadSettings); // config has been updated
   Object::connect(m_director_config_client.synchronized, this, &DirectorCore::multiSyncReloadSettings); // config has been updated
+  Object::connect(m_config_client.updated, this, &DirectorCore::queueReload); // a change set was applied
+  Object::connect(m_director_config_client.updated, this, &DirectorCore::queueReload); // a change set was applied
+
+  UserDatabase::instance().load();
+  Object::connect(m_account_watcher.filesChanged, this, &DirectorCore::accountsChanged);
+  Object::connect(m_account_watcher.overflowed,
+                  [this]() noexcept { accountsChanged({ USER_DATABASE_PASSWD, USER_DATABASE_GROUP }); });
+  m_account_watcher.watch(USER_DATABASE_DIR);
 }
 
 DirectorCore::~DirectorCore(void) noexcept
@@ -43,37 +59,67 @@ void DirectorCore::multiSyncReloadSettings(void) noexcept
   if(m_synchronized_count == 2) // ensure fully synchronized to avoid multiple reloads
   {
     m_synchronized_count = 0; // reset synch count for next sync
-    reloadSettings(); // actually reload settings
+    if(m_scan_pending) // claim the running processes before any provider is started
+    {
+      m_scan_pending = false;
+      m_scanning = true;
+      buildProcessMap();
+    }
+    else if(!m_scanning) // otherwise the scan reloads when done
+      reloadSettings(); // actually reload settings
   }
 }
 
-bool DirectorCore::buildProcessMap(void) noexcept
+// /proc is read on the worker pool, the processes are matched once the scan is done
+void DirectorCore::buildProcessMap(void) noexcept
 {
-  // search existing processes for those we should be managing (not 100% foolproof)
-  process_state_t state;
-  std::set<pid_t> pidlist;
-  const pid_t thispid = posix::getpid();
-  if(proclist(pidlist) == posix::success_response)
-  {
-    for(pid_t pid : pidlist)
-    {
-      posix::memset(reinterpret_cast<void*>(&state), 0, sizeof(state));
-      if(procstat(pid, state) && // if get process state works AND
-         (!state.parent_process_id || state.parent_process_id == thispid)) // process has unknown parent process OR director is the parent process
-        for(const std::string& config : getConfigList()) // try each config
-          if(getConfigValue(config, "/Process/Executable") == state.executable) // if the executable matches
+  std::function<std::vector<found_process_t>(void)> scan =
+      []() noexcept
+      {
+        std::vector<found_process_t> processes;
+        process_state_t state;
+        std::set<pid_t> pidlist;
+        if(proclist(pidlist) == posix::success_response)
+        {
+          processes.reserve(pidlist.size());
+          for(pid_t pid : pidlist)
           {
-            m_process_map[config]->add(thispid, pid); // claim this as a managed process
-            posix::memset(reinterpret_cast<void*>(&state), 0, sizeof(state)); // wipe process state for safety
-            for(pid_t childpid : pidlist)
-              if(procstat(childpid, state) && // if get process state works AND
-                 state.parent_process_id == pid) // process is a child of this parent pid
-                m_process_map[config]->add(pid, childpid); // claim this as a managed process
+            posix::memset(reinterpret_cast<void*>(&state), 0, sizeof(state));
+            if(procstat(pid, state)) // if get process state works
+              processes.push_back({ pid, state.parent_process_id, state.executable });
           }
-    }
-    return true;
-  }
-  return false;
+        }
+        return processes;
+      };
+  WorkerPool::instance().post<std::vector<found_process_t>>(scan,
+                                                            [this](std::vector<found_process_t> processes) noexcept
+                                                            {
+                                                              m_scanning = false;
+                                                              claimProcesses(processes);
+                                                              reloadSettings();
+                                                            });
+}
+
+// search existing processes for those we should be managing (not 100% foolproof)
+void DirectorCore::claimProcesses(const std::vector<found_process_t>& processes) noexcept
+{
+  const pid_t thispid = posix::getpid();
+  m_director_view = m_director_config_client.snapshot(); // the configs to match against (the reload that follows takes it again)
+  const std::list<std::string> configs = getConfigList();
+  for(const found_process_t& process : processes)
+    if(!process.parent_pid || process.parent_pid == thispid) // process has unknown parent process OR director is the parent process
+      for(const std::string& config : configs) // try each config
+        if(getConfigValue(config, "/Process/Executable") == process.executable) // if the executable matches
+        {
+          std::shared_ptr<JobContainer> job = createJob(config); // restarted like any other job when it exits
+          job->add(thispid, process.pid); // claim this as a managed process
+          for(const found_process_t& child : processes)
+            if(child.parent_pid == process.pid) // process is a child of this parent pid
+              job->add(process.pid, child.pid); // claim this as a managed process
+          if(job->getPids().empty()) // exited before it could be claimed
+            m_process_map.erase(config);
+          break; // one provider per process
+        }
 }
 
 posix::fd_t DirectorCore::shmStore(void) noexcept
@@ -85,6 +131,13 @@ posix::fd_t DirectorCore::shmStore(void) noexcept
     buffer_size += 4 + pair.first.size() + // string
                    4 + sizeof(posix::size_t) + // list size
                    (4 * pair.second->getPids().size() * 2 * sizeof(pid_t)); // list of pairs
+  buffer_size += 4 + sizeof(posix::size_t); // provider count of the descriptor store
+  for(auto& provider : m_descriptor_store.descriptors())
+  {
+    buffer_size += 4 + provider.first.size() + 4 + sizeof(posix::size_t);
+    for(auto& pair : provider.second)
+      buffer_size += 4 + pair.first.size() + 4 + sizeof(posix::fd_t); // name and descriptor
+  }
   // end buffer size calculation
 
   posix::fd_t shmid = ::shmget(IPC_PRIVATE, buffer_size, IPC_CREAT | SHM_R | SHM_W); // create shared memory segment
@@ -112,6 +165,14 @@ posix::fd_t DirectorCore::shmStore(void) noexcept
         for(auto& pair : list)
           storage << pair.first << pair.second;
       }
+
+      storage << m_descriptor_store.descriptors().size();
+      for(auto& provider : m_descriptor_store.descriptors())
+      {
+        storage << provider.first << provider.second.size();
+        for(auto& pair : provider.second)
+          storage << pair.first << pair.second;
+      }
     }
   }
   return shmid;
@@ -147,13 +208,29 @@ bool DirectorCore::shmLoad(posix::fd_t shmid) noexcept
       for(posix::size_t i = 0; i < job_count; ++i)
       {
         storage >> name >> pid_count;
-        std::shared_ptr<JobContainer> proc = m_process_map[name];
+        std::shared_ptr<JobContainer> proc = createJob(name); // restarted like any other job when it exits
         for(posix::size_t j = 0; j < pid_count; ++j)
         {
           storage >> parent_pid >> child_pid;
           proc->add(parent_pid, child_pid);
         }
       }
+
+      posix::size_t provider_count = 0;
+      posix::size_t fd_count = 0;
+      std::string fd_name;
+      posix::fd_t fd = posix::invalid_descriptor;
+      storage >> provider_count; // descriptors kept open across exec()
+      for(posix::size_t i = 0; !storage.hadError() && i < provider_count; ++i)
+      {
+        storage >> name >> fd_count;
+        for(posix::size_t j = 0; !storage.hadError() && j < fd_count; ++j)
+        {
+          storage >> fd_name >> fd;
+          if(!storage.hadError())
+            m_descriptor_store.adopt(name, fd_name, fd);
+        }
+      }
       posix::memset(reload_buffer, 0, buffer_size); // zero out shared memory for safety
     }
     ::shmctl(shmid, IPC_RMID, nullptr); // release shared memory
@@ -184,6 +261,7 @@ void DirectorCore::reloadBinary(void) noexcept
   {
     // reload process
     process_state_t data;
+    m_descriptor_store.handOff(); // the new image adopts the stored descriptors
     if(procstat(posix::getpid(), data))
       posix::execl(data.executable.c_str(), data.executable.c_str(), std::to_string(shmid).c_str(), NULL);
     terminal::write("%s%s\n", terminal::critical, "Failed to reload Director from binary!");
@@ -191,51 +269,134 @@ void DirectorCore::reloadBinary(void) noexcept
   }
 }
 
+// gather bursts of pushed changes into a single reload
+void DirectorCore::queueReload(void) noexcept
+{
+  if(m_scan_pending || m_scanning) // the full reload after the scan covers it
+    return;
+  if(!m_reload_timer)
+    m_reload_timer = TimerWheel::instance().schedule(DIRECTOR_RELOAD_WINDOW,
+                                                     [this]() noexcept { m_reload_timer = 0; reloadChanges(); });
+}
 
-inline bool starts_with(const std::string& str, const char* seek)
-  { return posix::memcmp(str.data(), seek, strlen(seek)) == 0; }
+void DirectorCore::reloadChanges(void) noexcept
+{
+  applySettings(m_config_client.takeChanges(),
+                m_director_config_client.takeChanges());
+}
 
 void DirectorCore::reloadSettings(void) noexcept
 {
+  changeset_t everything;
+  everything.everything = true;
+  if(m_reload_timer) // a full reload covers pending changes
+    TimerWheel::instance().cancel(m_reload_timer);
+  m_reload_timer = 0;
+  m_config_client.takeChanges(); // discard accumulated changes
+  m_director_config_client.takeChanges();
+  applySettings(everything, everything);
+  m_director_config_client.logMemoryReport();
+}
+
+bool DirectorCore::rebuildRunlevelAliases(void) noexcept
+{
+  std::map<std::string, runlevel_t> previous_aliases;
+  std::swap(previous_aliases, m_runlevel_aliases);
+
+  // replace existing runlevels with only special runlevels
+  m_runlevel_aliases = { {"bootstrap", -1},
+                         {"reboot"   , -2},
+                         {"halt"     , -3},
+                         {"poweroff" , -4} };
+
+  // add custom runlevel aliases
+  const configmap_t& runlevels = m_config_view->subtree("/Runlevels/");
+  for(auto entry = runlevels.begin(); entry != runlevels.end(); ++entry) // check only runlevel alias entries
+  {
+    runlevel_t rl = invalid_runlevel;
+    const std::string alias = entry->first.substr(sizeof("/Runlevels/") - 1);
+    // std::map<std::string, runlevel_t>::const_iterator iter =
+    auto iter = m_runlevel_aliases.find(entry->second);
+    if(iter == m_runlevel_aliases.end()) // if runlevel value doesn't exist
+      rl = convert_to_runlevel(entry->second, invalid_runlevel); // convert string value to runlevel value (if possible)
+    else // if runlevel value already exists
+      rl = iter->second; // copy value
+
+    m_runlevel_aliases.emplace(alias, rl); // add new alias (or ignore if already existing)
+
+    if(rl == invalid_runlevel)
+      posix::syslog << posix::priority::warning
+                    << "Runlevel alias \"%1\" is invalid because \"%2\" is neither an existing runlevel alias nor a valid positive 16-bit integer."
+                    << alias
+                    << entry->second
+                    << posix::eom;
+  }
+
+  return m_runlevel_aliases != previous_aliases; // report if runlevel numbers may have changed
+}
+
+// decode the configuration of each changed provider
+void DirectorCore::compileProviderConfigs(const changeset_t& changes) noexcept
+{
+  if(changes.everything || changes.configs_changed) // if providers were added or removed
+  {
+    m_provider_configs.clear();
+    m_names.clear(); // running jobs keep their own copies of names
+    for(const std::string& config : getConfigList())
+      m_provider_configs.emplace(config, compile_provider_config(getConfigData(config), m_names));
+  }
+  else
+    for(const auto& pair : changes.keys) // recompile only the providers with changed keys
+      m_provider_configs[pair.first] = compile_provider_config(getConfigData(pair.first), m_names);
+}
+
+// users or groups changed: the spawn plans hold resolved credentials
+void DirectorCore::accountsChanged(const std::set<std::string>& files) noexcept
+{
+  if(!files.count(USER_DATABASE_PASSWD) && !files.count(USER_DATABASE_GROUP))
+    return;
+  UserDatabase::instance().load();
+  if(m_config_client.isSynchronized() &&
+     m_director_config_client.isSynchronized())
+  {
+    changeset_t everything;
+    everything.everything = true;
+    compileProviderConfigs(everything);
+  }
+}
+
+// only redo the work that the changes require
+void DirectorCore::applySettings(const changeset_t& config_changes, const changeset_t& director_changes) noexcept
+{
+  m_config_view = m_config_client.snapshot(); // everything below reads one consistent view
+  m_director_view = m_director_config_client.snapshot();
+
   if(m_config_client.isSynchronized() && // ensure fully synchronized to avoid multiple reloads
      m_director_config_client.isSynchronized())
   {
-    // replace existing runlevels with only special runlevels
-    m_runlevel_aliases = { {"bootstrap", -1},
-                           {"reboot"   , -2},
-                           {"halt"     , -3},
-                           {"poweroff" , -4} };
-
-    // add custom runlevel aliases
-    for(const std::pair<std::string, std::string>& pair : m_config_client.data()) // check every config client entry
-    {
-      if(starts_with(pair.first, "/Runlevels/")) // if this is a runlevel alias entry
-      {
-        runlevel_t rl = invalid_runlevel;
-        // std::map<std::string, runlevel_t>::const_iterator iter =
-        auto iter = m_runlevel_aliases.find(pair.second);
-        if(iter == m_runlevel_aliases.end()) // if runlevel value doesn't exist
-          rl = convert_to_runlevel(pair.second, invalid_runlevel); // convert string value to runlevel value (if possible)
-        else // if runlevel value already exists
-          rl = iter->second; // copy value
-
-        m_runlevel_aliases.emplace(pair.first.substr(sizeof("/Runlevels/") - 1), rl); // add new alias (or ignore if already existing)
-
-        if(rl == invalid_runlevel)
-          posix::syslog << posix::priority::warning
-                        << "Runlevel alias \"%1\" is invalid because \"%2\" is neither an existing runlevel alias nor a valid positive 16-bit integer."
-                        << pair.first.substr(sizeof("/Runlevels/") - 1)
-                        << pair.second
-                        << posix::eom;
-      }
-    }
+    bool aliases_changed = false;
+    if(config_changes.touches("/Runlevels/")) // if any runlevel alias changed
+      aliases_changed = rebuildRunlevelAliases();
+
+    compileProviderConfigs(director_changes);
+
+    bool graph_changed = aliases_changed ||
+                         director_changes.configs_changed ||
+                         director_changes.touches("/Requirements/") ||
+                         director_changes.touches("/Enhancements/") ||
+                         director_changes.touches("/Process/ProvidedServices");
 
-    resolveDependencies();
+    if(graph_changed) // if the dependency graph may have changed
+      resolveDependencies();
 
-    if(!m_action_queue.empty()) // sync interrupted job queue
+    if(!m_action_queue.empty()) // if busy with jobs
     {
-      m_action_queue = std::queue<std::pair<bool, std::string>>(); // clear action queue
-      setRunlevel(m_runlevel); // restart runlevel change
+      if(graph_changed) // sync interrupted job queue
+      {
+        m_action_queue = std::queue<std::pair<bool, std::string>>(); // clear action queue
+        m_restarting = false;
+        setRunlevel(m_runlevel); // restart runlevel change
+      }
     }
     else if(m_runlevel.empty()) // runlevel is empty if the director was just just started
     {
@@ -244,24 +405,22 @@ void DirectorCore::reloadSettings(void) noexcept
       assert(setRunlevel("bootstrap")); // switch to the system init runlevel
     }
     else if(m_runlevel == "bootstrap")
-      setRunlevel(m_config_client.get("/Settings/InitialRunlevel")); // switch to the initial runlevel
+      setRunlevel(m_config_view->get("/Settings/InitialRunlevel")); // switch to the initial runlevel
   }
 }
 
 
 inline const std::string& DirectorCore::getConfigValue(const std::string& config, const std::string& key) const noexcept
 {
-  return m_director_config_client.get(config, key);
-}
-
-inline std::list<std::string> DirectorCore::getConfigValues(const std::string& config, const std::string& key) const noexcept
-{
-  return clean_explode(m_director_config_client.get(config, key), LIST_DELIM);
+  return m_director_view->get(config, key);
 }
 
 inline std::list<std::string> DirectorCore::getConfigList(void) const noexcept
 {
-  return m_director_config_client.listConfigs();
+  std::list<std::string> names;
+  for(const auto& pair : m_director_view->configs)
+    names.emplace_back(pair.first);
+  return names;
 }
 
 inline DependencySolver::runlevel_t DirectorCore::getRunlevelNumber(const std::string& rlname) const noexcept
@@ -273,9 +432,9 @@ inline DependencySolver::runlevel_t DirectorCore::getRunlevelNumber(const std::s
   return iter->second;
 }
 
-inline const std::unordered_map<std::string, std::string>& DirectorCore::getConfigData(const std::string& config) const noexcept
+inline const ConfigTable& DirectorCore::getConfigData(const std::string& config) const noexcept
 {
-  return m_director_config_client.data(config);
+  return m_director_view->data(config);
 }
 
 bool DirectorCore::setRunlevel(const std::string& rlname) noexcept
@@ -288,19 +447,83 @@ bool DirectorCore::setRunlevel(const std::string& rlname) noexcept
      rlnum == getRunlevelNumber(m_runlevel)) // already set
     return false;
 
+  const bool booting = m_runlevel.empty() || m_runlevel == "bootstrap";
   m_action_queue = getRunlevelOrder(rlname);
   m_runlevel = rlname;
 
-  Object::singleShot(this, &DirectorCore::processJob);
+  if(booting) // disks are cold: read ahead what the runlevel needs
+    prefetchRunlevel();
+  else
+    Object::singleShot(this, &DirectorCore::processJob);
   return true;
 }
 
+// hint the executables of the providers about to start, the first job waits until the hints are issued
+void DirectorCore::prefetchRunlevel(void) noexcept
+{
+  std::vector<std::string> paths;
+  std::queue<std::pair<bool, std::string>> actions = m_action_queue;
+  for(; !actions.empty(); actions.pop())
+    if(actions.front().first) // if starting provider
+      paths.push_back(getConfigValue(actions.front().second, "/Process/Executable"));
+  m_prefetch.prefetch(paths, [this]() noexcept { processJob(); });
+}
+
+// the boot is done: remember every file the providers mapped for the next boot
+void DirectorCore::recordPrefetch(void) noexcept
+{
+  std::vector<pid_t> pids;
+  for(auto& pair : m_process_map)
+    for(const auto& pids_pair : pair.second->getPids())
+      pids.push_back(pids_pair.second);
+
+  // providers running as other users only let the original ids read their maps
+  uid_t director_uid = posix::geteuid();
+  bool privileged = director_uid == m_euid || posix::seteuid(m_euid);
+  std::set<std::string> files = BootPrefetch::mappedFiles(pids);
+  if(privileged && director_uid != m_euid && !posix::seteuid(director_uid))
+    posix::syslog << posix::priority::critical
+                  << "Unable to return to effective UID %1 after recording the boot."_xlate
+                  << director_uid
+                  << posix::eom;
+  m_prefetch.record(files);
+}
+
+// a job for 'config' with its signals connected
+std::shared_ptr<JobContainer> DirectorCore::createJob(const std::string& config) noexcept
+{
+  auto rval = m_process_map.emplace(config, nullptr);
+  if(rval.second)
+  {
+    std::shared_ptr<JobContainer> job = std::make_shared<JobContainer>(config);
+    Object::connect(job->startSuccess, this, &DirectorCore::processJob);
+    Object::connect(job->stopSuccess , this, &DirectorCore::jobDone);
+    Object::connect(job->exited,
+                    [this, config](posix::error_t) noexcept // copy 'config' because the action queue will change
+                      { providerExited(config); });
+    Object::connect(job->quorumLost,
+                    [this, config]() noexcept { providerExited(config); }); // too few instances left: restart them all
+    rval.first->second = job;
+  }
+  return rval.first->second;
+}
+
 void DirectorCore::processJob(void) noexcept
 {
   if(m_action_queue.empty())
   {
-    terminal::write("runlevel is now: '%s'\n", m_runlevel.c_str());
-    Object::enqueue(runlevel_changed, m_runlevel);
+    if(m_restarting) // if finished restarting a failed provider
+      m_restarting = false;
+    else
+    {
+      terminal::write("runlevel is now: '%s'\n", m_runlevel.c_str());
+      Object::enqueue(runlevel_changed, m_runlevel);
+      if(m_runlevel != "bootstrap" && !m_prefetch.isRecorded()) // reached the initial runlevel
+        recordPrefetch();
+    }
+
+    if(!m_failed_providers.empty()) // if more failed providers are waiting
+      Object::singleShot(this, &DirectorCore::restartProviders);
   }
   else
   {
@@ -308,13 +531,14 @@ void DirectorCore::processJob(void) noexcept
     const bool& start = pair.first;
     const std::string& config = pair.second;
 
-    if(getConfigData(config).empty()) // if the config file dons NOT exist
+    auto compiled = m_provider_configs.find(config);
+    if(compiled == m_provider_configs.end()) // if the config file dons NOT exist
     {
       m_log << "No configuration for provider %1 was found."_xlate << config << posix::eom;
     }
     else // if the config file exists
     {
-      std::list<std::string> services = getConfigValues(config, "/Process/ProvidedServices");
+      const provider_config_t& provider = compiled->second;
 
       if(start) // if starting provider
       {
@@ -322,56 +546,48 @@ void DirectorCore::processJob(void) noexcept
         auto iter = m_process_map.find(config); // look to see if already started
         if(iter == m_process_map.end()) // if not already started
         {
-          for(const std::string& service : getConfigValues(config, "/Requirements/ActiveServices"))
-            if(!service_exists(service)) // service should exists
+          for(strid_t service : provider.active_services)
+            if(!service_exists(m_names.str(service))) // service should exists
               m_log << "Provider: %1\nField: %3\nError: failed to start\nCause: service %2 must be active"_xlate
                     << config
-                    << service
+                    << m_names.str(service)
                     << "/Requirements/ActiveServices"
                     << posix::eom; // record error
 
-          for(const std::string& service : getConfigValues(config, "/Requirements/InactiveServices"))
-            if(service_exists(service)) // service should NOT exist
+          for(strid_t service : provider.inactive_services)
+            if(service_exists(m_names.str(service))) // service should NOT exist
               m_log << "Provider: %1\nField: %3\nError: failed to start\nCause: service %2 must be inactive"_xlate
                     << config
-                    << service
+                    << m_names.str(service)
                     << "/Requirements/InactiveServices"
                     << posix::eom; // record error
 
-          for(const std::string& provider : getConfigValues(config, "/Requirements/ActiveProviders"))
-            if(m_process_map.find(provider) == m_process_map.end()) // provider should be running
+          for(strid_t dependency : provider.active_providers)
+            if(m_process_map.find(m_names.str(dependency)) == m_process_map.end()) // provider should be running
               m_log << "Provider: %1\nField: %3\nError: failed to start\nCause: provider %2 must be active"_xlate
                     << config
-                    << provider
+                    << m_names.str(dependency)
                     << "/Requirements/ActiveProviders"
                     << posix::eom; // record error
 
-          for(const std::string& provider : getConfigValues(config, "/Requirements/InactiveProviders"))
-            if(m_process_map.find(provider) != m_process_map.end()) // provider should NOT be running
+          for(strid_t dependency : provider.inactive_providers)
+            if(m_process_map.find(m_names.str(dependency)) != m_process_map.end()) // provider should NOT be running
               m_log << "Provider: %1\nField: %3\nError: failed to start\nCause: provider %2 must be inactive"_xlate
                     << config
-                    << provider
+                    << m_names.str(dependency)
                     << "/Requirements/InactiveProviders"
                     << posix::eom; // record error
 
           if(m_log.empty()) // process requirements are satisified
           {
-            // std::pair<std::unordered_map<std::string, std::shared_ptr<JobContainer>>::iterator,bool> rval =
-            auto rval = m_process_map.emplace(config, std::make_shared<JobContainer>(config));
-            if(rval.second)
-            {
-              std::shared_ptr<JobContainer> job = rval.first->second;
-              Object::connect(job->startSuccess, this, &DirectorCore::processJob);
-              Object::connect(job->stopSuccess , this, &DirectorCore::processJob);
-              job->start(std::stoi(getConfigValue(config, "/Process/StartTimeout")),
-                         services,
-                         getConfigData(config));
-            }
+            if(!m_restarting) // started on purpose: earlier failures no longer count
+              forgetRestarts(config);
+            createJob(config)->start(provider, m_names, getConfigData(config));
           }
         }
         else // if already started
         {
-          for(const std::string& service : services) // check all services (if any)
+          for(const std::string& service : iter->second->providedServices()) // check all services (if any)
             if(!service_exists(service)) // ensure service exists
               m_log << "Provider: %1\nField: %3\nError: not providing service\nCause: service %2 does not exist."_xlate
                     << config
@@ -387,13 +603,7 @@ void DirectorCore::processJob(void) noexcept
       {
         auto iter = m_process_map.find(config);
         if(iter != m_process_map.end())
-        {
-          std::shared_ptr<JobContainer> job = iter->second;
-          job->stop(std::stoi(getConfigValue(config, "/Exiting/Timeout")),
-                    services,
-                    decode_signal_name(getConfigValue(config, "/Exiting/Signal")),
-                    getConfigValue(config, "/Exiting/ExitWaitType"));
-        }
+          iter->second->stop(provider);
       }
     }
 
@@ -409,7 +619,14 @@ void DirectorCore::jobDone(void) noexcept
   const std::string& config = pair.second;
   //display::providerStatus(config, start ? "active" : "stopped");
   if(!start) // if job is ending a process
+  {
     m_process_map.erase(config); // remove dead process
+    if(!m_restarting) // if not coming back
+    {
+      m_descriptor_store.release(config); // drop the descriptors it kept for its next start
+      forgetRestarts(config); // stopped on purpose
+    }
+  }
   m_action_queue.pop(); // action has been fulfilled
   Object::singleShot(this, &DirectorCore::processJob); // start the next job
 }
@@ -428,3 +645,100 @@ void DirectorCore::jobStuck(void) noexcept
 
   m_log.clear();
 }
+
+void DirectorCore::providerExited(const std::string& config) noexcept
+{
+  if(!m_action_queue.empty() &&
+     !m_action_queue.front().first && // if stopping a provider AND
+     m_action_queue.front().second == config) // it's this provider
+    return; // exit was expected
+
+  restart_state_t& restart = m_restarts[config];
+  if(restart.stable) // did not run long enough to count as recovered
+    TimerWheel::instance().cancel(restart.stable);
+  restart.stable = 0;
+  if(restart.backoff) // already waiting to restart
+    return;
+
+  if(restart.attempts >= DIRECTOR_RESTART_LIMIT)
+  {
+    posix::syslog << posix::priority::error
+                  << "Provider %1 failed %2 times in a row and will not be restarted."_xlate
+                  << config
+                  << int(restart.attempts)
+                  << posix::eom;
+    m_process_map.erase(config); // remove dead process
+    m_descriptor_store.release(config);
+    return;
+  }
+
+  milliseconds_t delay = restart_backoff(restart.attempts);
+  ++restart.attempts;
+
+  // the wait does not hold the action queue: runlevel changes go ahead meanwhile
+  restart.backoff = TimerWheel::instance().schedule(delay,
+                                                    [this, config]() noexcept
+                                                    {
+                                                      m_restarts[config].backoff = 0;
+                                                      m_failed_providers.push(config);
+                                                      if(m_action_queue.empty()) // if not busy with other jobs
+                                                        restartProviders();
+                                                    });
+}
+
+// cancel pending restarts and clear the failure count
+void DirectorCore::forgetRestarts(const std::string& config) noexcept
+{
+  auto iter = m_restarts.find(config);
+  if(iter == m_restarts.end())
+    return;
+  if(iter->second.backoff)
+    TimerWheel::instance().cancel(iter->second.backoff);
+  if(iter->second.stable)
+    TimerWheel::instance().cancel(iter->second.stable);
+  m_restarts.erase(iter);
+}
+
+std::string DirectorCore::providerOfPid(pid_t pid) noexcept
+{
+  for(auto& pair : m_process_map)
+    for(const std::pair<pid_t, pid_t>& pids : pair.second->getPids())
+      if(pids.second == pid)
+        return pair.first;
+  return std::string();
+}
+
+// restart a failed provider and only the providers that depend on it
+void DirectorCore::restartProviders(void) noexcept
+{
+  if(!m_action_queue.empty() || // if busy with other jobs OR
+     m_failed_providers.empty()) // nothing to restart
+    return;
+
+  const std::string config = m_failed_providers.front();
+  m_failed_providers.pop();
+
+  auto job = m_process_map.find(config);
+  auto compiled = m_provider_configs.find(config);
+  if(job != m_process_map.end() &&
+     compiled != m_provider_configs.end() &&
+     !job->second->getPids().empty()) // instances that are still running restart with the rest
+    job->second->sendSignal(compiled->second.exit_signal);
+  m_process_map.erase(config); // remove dead process
+
+  std::set<std::string> active_providers;
+  for(const auto& pair : m_process_map)
+    active_providers.emplace(pair.first);
+
+  m_action_queue = getRestartOrder(config, active_providers);
+  m_restarting = true;
+
+  restart_state_t& restart = m_restarts[config];
+  restart.stable = TimerWheel::instance().schedule(DIRECTOR_RESTART_STABLE,
+                                                   [this, config]() noexcept
+                                                   {
+                                                     m_restarts[config].stable = 0;
+                                                     forgetRestarts(config); // it recovered
+                                                   });
+  Object::singleShot(this, &DirectorCore::processJob);
+}
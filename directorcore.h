@@ -6,6 +6,7 @@
 #include <unordered_map>
 #include <map>
 #include <memory>
+#include <vector>
 
 // PUT
 #include <put/object.h>
@@ -17,6 +18,18 @@
 #include "directorconfigclient.h"
 #include "dependencysolver.h"
 #include "jobcontainer.h"
+#include "descriptorstore.h"
+#include "changeset.h"
+#include "timerwheel.h"
+#include "providerconfig.h"
+#include "stringpool.h"
+#include "configsnapshot.h"
+#include "configwatcher.h"
+#include "bootprefetch.h"
+
+#ifndef DIRECTOR_RELOAD_WINDOW
+#define DIRECTOR_RELOAD_WINDOW  50 // milliseconds to gather bursts of configuration changes
+#endif
 
 class DirectorCore : public Object,
                      public DependencySolver
@@ -37,31 +50,70 @@ private:
   virtual std::list<std::string> getConfigList(void) const noexcept;
   virtual runlevel_t getRunlevelNumber(const std::string& rlname) const noexcept;
 // privately used stortcuts
-  std::list<std::string> getConfigValues(const std::string& config, const std::string& key) const noexcept;
-  const std::unordered_map<std::string, std::string>& getConfigData(const std::string& config) const noexcept;
+  const ConfigTable& getConfigData(const std::string& config) const noexcept;
 
 // signals
   signal<std::string> runlevel_changed;
 
 // functions
-  bool buildProcessMap(void) noexcept;
+  struct found_process_t
+  {
+    pid_t pid;
+    pid_t parent_pid;
+    std::string executable;
+  };
+  void buildProcessMap(void) noexcept;
+  void claimProcesses(const std::vector<found_process_t>& processes) noexcept;
   posix::fd_t shmStore(void) noexcept;
   bool shmLoad(posix::fd_t shmid) noexcept;
+  std::shared_ptr<JobContainer> createJob(const std::string& config) noexcept;
   void processJob(void) noexcept;
+  void prefetchRunlevel(void) noexcept;
+  void recordPrefetch(void) noexcept;
   void jobDone(void) noexcept;
   void jobStuck(void) noexcept;
+  void providerExited(const std::string& config) noexcept;
+  std::string providerOfPid(pid_t pid) noexcept;
+  void restartProviders(void) noexcept;
 
 // variables
   std::string m_runlevel;
   std::map<std::string, runlevel_t> m_runlevel_aliases;
   std::unordered_map<std::string, std::shared_ptr<JobContainer>> m_process_map; // indexed by provider name
+  std::unordered_map<std::string, provider_config_t> m_provider_configs; // decoded on reload, indexed by provider name
+  StringPool m_names; // service and provider names referenced by m_provider_configs
 
   std::queue<std::pair<bool, std::string>> m_action_queue; // bool (start/stop) + name
+  std::queue<std::string> m_failed_providers; // providers that exited unexpectedly and await a restart
+  bool m_restarting;
+
+  struct restart_state_t
+  {
+    uint8_t attempts = 0; // restarts since the provider last ran long enough
+    TimerWheel::handle_t backoff = 0; // pending restart
+    TimerWheel::handle_t stable = 0; // clears 'attempts' when it fires
+  };
+  std::unordered_map<std::string, restart_state_t> m_restarts; // indexed by provider name
+  void forgetRestarts(const std::string& config) noexcept;
+  DescriptorStore m_descriptor_store;
+  BootPrefetch m_prefetch;
 
   void multiSyncReloadSettings(void) noexcept;
+  void queueReload(void) noexcept;
+  void reloadChanges(void) noexcept;
+  void accountsChanged(const std::set<std::string>& files) noexcept;
+  void applySettings(const changeset_t& config_changes, const changeset_t& director_changes) noexcept;
+  bool rebuildRunlevelAliases(void) noexcept;
+  void compileProviderConfigs(const changeset_t& changes) noexcept;
   uint8_t m_synchronized_count;
+  bool m_scan_pending; // the process map is rebuilt on the first synchronization
+  bool m_scanning; // reloading waits for the running processes to be claimed
+  TimerWheel::handle_t m_reload_timer; // zero when no reload is pending
   ConfigClient m_config_client;
   DirectorConfigClient m_director_config_client;
+  config_view_t m_config_view; // config data as of the last reload
+  director_config_view_t m_director_view; // provider data as of the last reload
+  ConfigWatcher m_account_watcher; // reports edits of the passwd and group files
   uid_t m_euid;
   gid_t m_egid;
   ErrorLogStream m_log;
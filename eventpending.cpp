@@ -4,27 +4,70 @@
 #include <climits>
 
 // PUT
-#include "servicecheck.h"
 #include <put/specialized/procstat.h>
 
+// Director
+#include "servicecheck.h"
+#include "workerpool.h"
+
 EventPending::EventPending(void) noexcept
-  : m_timeout_count(0), m_max_timeout_count(0)
+  : m_timer(0), m_checking(false), m_check_id(0), m_alive(std::make_shared<bool>(true)),
+    m_interval(0), m_timeout_count(0), m_max_timeout_count(0)
+{
+}
+
+void EventPending::cancel(void) noexcept
+{
+  if(m_timer)
+    TimerWheel::instance().cancel(m_timer);
+  m_timer = 0;
+  m_checking = false;
+  ++m_check_id; // drop the result of a running check
+}
+
+void EventPending::trigger(void) noexcept
 {
-  Object::connect(m_timer.expired, this, &EventPending::timerExpired);
+  cancel();
+  Object::enqueue(event_trigger);
 }
 
 void EventPending::timerExpired(void) noexcept
 {
-  if(activateTrigger())
-  {
+  m_timer = 0; // the wheel entry has been consumed
+  check_t check = blockingTrigger();
+  if(!check)
+    return checked(activateTrigger());
+
+  m_checking = true;
+  std::weak_ptr<bool> alive = m_alive;
+  uint64_t id = ++m_check_id;
+  WorkerPool::instance().post<bool>(check,
+                                    [this, alive, id](bool triggered) noexcept
+                                    {
+                                      if(!alive.expired() && id == m_check_id) // if still waiting for this check
+                                      {
+                                        m_checking = false;
+                                        checked(triggered);
+                                      }
+                                    });
+}
+
+void EventPending::checked(bool triggered) noexcept
+{
+  if(triggered)
     Object::enqueue(event_trigger);
-    m_timer.stop();
-  }
   else if(++m_timeout_count >= m_max_timeout_count) // increment and check if timeout count has been met
-  {
     Object::enqueue(event_timeout);
-    m_timer.stop();
-  }
+  else // check again later
+    m_timer = TimerWheel::instance().schedule(m_interval, [this]() noexcept { timerExpired(); });
+}
+
+bool EventPending::wait(milliseconds_t interval) noexcept
+{
+  cancel(); // replace any previous wait
+  m_interval = interval;
+  m_timer = TimerWheel::instance().schedule(m_interval, [this]() noexcept { timerExpired(); });
+  return m_timer != 0;
 }
 
 // Ensure the timer doesn't check to frequently or infrequently
@@ -48,7 +91,15 @@ bool EventPending::setTimeout(milliseconds_t timeout) noexcept
     m_max_timeout_count = 1;
   }
 
-  return m_timer.start(timeout, true);
+  return wait(timeout);
+}
+
+bool EventPending::setDeadline(milliseconds_t timeout) noexcept
+{
+  m_timeout_count = 0;
+  m_max_timeout_count = 1;
+
+  return wait(timeout);
 }
 
 // test if they exist or not
@@ -60,22 +111,39 @@ bool ExitPending::activateTrigger(void) noexcept
       if(service_exists(service))
         return false;
   }
-  else if(!m_pids.empty())
+  return true;
+}
+
+// processes are checked on the worker pool with a copy of the PIDs
+EventPending::check_t ExitPending::blockingTrigger(void) noexcept
+{
+  if(!m_services.empty() || m_pids.empty())
+    return check_t();
+
+  std::list<std::pair<pid_t, pid_t>> pids = m_pids;
+  return [pids]() noexcept
   {
     struct process_state_t state;
-    for(const std::pair<pid_t, pid_t>& pid_pair : m_pids)
+    for(const std::pair<pid_t, pid_t>& pid_pair : pids)
       if(procstat(pid_pair.second, state) &&
          state.state != Zombie)
         return false;
-  }
-  return true;
+    return true;
+  };
 }
 
-// test if they exist or not
+// test if enough instances have all of their services
 bool StartPending::activateTrigger(void) noexcept
 {
-  for(const std::string& service : m_services)
-    if(service_exists(service))
-      return false;
-  return true;
+  posix::size_t ready = 0;
+  for(const std::list<std::string>& services : m_instances)
+  {
+    bool instance_ready = true;
+    for(const std::string& service : services)
+      if(!service_exists(service))
+        { instance_ready = false; break; }
+    if(instance_ready && ++ready >= m_quorum)
+      return true;
+  }
+  return ready >= m_quorum;
 }
@@ -4,27 +4,44 @@
 // STL
 #include <set>
 #include <list>
+#include <vector>
 #include <string>
+#include <memory>
+#include <functional>
 
 // PUT
 #include <put/object.h>
-#include <put/specialized/timerevent.h>
+
+// Director
+#include "timerwheel.h"
 
 class EventPending : public Object
 {
 public:
   EventPending(void) noexcept;
-  virtual ~EventPending(void) noexcept { }
+  virtual ~EventPending(void) noexcept { cancel(); }
 
-  bool setTimeout(milliseconds_t timeout) noexcept;
+  bool setTimeout(milliseconds_t timeout) noexcept; // poll periodically until the timeout
+  bool setDeadline(milliseconds_t timeout) noexcept; // check only once the timeout is reached
+  void cancel(void) noexcept;
+  void trigger(void) noexcept; // the event happened: stop waiting
+  bool isPending(void) const noexcept { return m_timer != 0 || m_checking; }
 
   signal<> event_timeout;
   signal<> event_trigger;
 protected:
+  typedef std::function<bool(void)> check_t;
   virtual bool activateTrigger(void) noexcept = 0;
+  virtual check_t blockingTrigger(void) noexcept { return check_t(); } // check to run on the worker pool instead
 private:
   void timerExpired(void) noexcept;
-  TimerEvent m_timer;
+  void checked(bool triggered) noexcept;
+  bool wait(milliseconds_t interval) noexcept;
+  TimerWheel::handle_t m_timer; // zero when not waiting
+  bool m_checking; // a blocking check is running on the worker pool
+  uint64_t m_check_id; // stale check results are ignored
+  std::shared_ptr<bool> m_alive; // completions may outlive this object
+  milliseconds_t m_interval;
   milliseconds_t m_timeout_count;
   milliseconds_t m_max_timeout_count;
 };
@@ -38,11 +55,15 @@ public:
   void setPids(const std::list<std::pair<pid_t, pid_t>>& pids) noexcept
     { m_services.clear(); m_pids = pids; }
 
+  void processesExited(void) noexcept // all tracked processes are gone
+    { if(isPending() && !m_pids.empty()) trigger(); }
+
   void setServices(const std::list<std::string>& services) noexcept
     { m_pids.clear(); m_services = services; }
 
 private:
   bool activateTrigger(void) noexcept;
+  check_t blockingTrigger(void) noexcept; // reading /proc may stall
   std::list<std::pair<pid_t, pid_t>> m_pids;
   std::list<std::string> m_services;
 };
@@ -50,15 +71,20 @@ private:
 class StartPending : public EventPending
 {
 public:
-  StartPending (void) noexcept { }
+  StartPending (void) noexcept : m_quorum(1) { }
   ~StartPending(void) noexcept { }
 
   void setServices(const std::list<std::string>& services) noexcept
-    { m_services = services; }
+    { m_instances.assign(1, services); m_quorum = 1; }
+
+  // services of each instance and how many instances must be up
+  void setServices(const std::vector<std::list<std::string>>& instances, posix::size_t quorum) noexcept
+    { m_instances = instances; m_quorum = quorum; }
 
 private:
   bool activateTrigger(void) noexcept;
-  std::list<std::string> m_services;
+  std::vector<std::list<std::string>> m_instances;
+  posix::size_t m_quorum;
 };
 
 #endif // EXITPENDING_H
@@ -1,28 +1,235 @@
 #include "jobcontainer.h"
 
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+#include <sys/wait.h>
+
+#include <algorithm>
+
 #include <put/cxxutils/translate.h>
-#include <put/cxxutils/hashing.h>
 #include "servicecheck.h"
+#include "string_helpers.h"
+
+// service name of a single instance: "service.N"
+static std::string instance_service(const std::string& service, uint16_t instance) noexcept
+  { return service + '.' + std::to_string(instance); }
+
+// pin an instance to a processor (round robin when there are more instances than processors)
+static void pin_instance(pid_t pid, uint16_t instance) noexcept
+{
+#if defined(__linux__)
+  long cpu_count = ::sysconf(_SC_NPROCESSORS_ONLN);
+  if(pid > 0 && cpu_count > 0)
+  {
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(instance % cpu_count, &cpus);
+    ::sched_setaffinity(pid, sizeof(cpus), &cpus);
+  }
+#else
+  (void)pid;
+  (void)instance;
+#endif
+}
 
 JobContainer::JobContainer(const std::string& name) noexcept
-  : m_name(name)
+  : m_name(name),
+    m_quorum(1),
+    m_stopping(false)
 {
   Object::connect(m_waitstart.event_trigger, startSuccess); // job started properly :)
   Object::connect(m_waitexit.event_trigger , stopSuccess); // job exited properly :)
+  Object::connect(exited, [this](posix::error_t) noexcept { cancelRespawns(); reapSpawned(); m_waitexit.processesExited(); }); // every process has exited
+  Object::connect(processExited, [this](pid_t pid, posix::error_t) noexcept { reapSpawned(pid); instanceExited(pid); });
+}
+
+JobContainer::~JobContainer(void) noexcept
+{
+  cancelRespawns();
+}
+
+// one instance going away must not wait for the whole job to exit
+void JobContainer::instanceExited(pid_t pid) noexcept
+{
+  auto iter = std::find(m_instance_pids.begin(), m_instance_pids.end(), pid);
+  if(iter == m_instance_pids.end() || m_stopping) // not an instance or stopping anyway
+    return;
+  *iter = 0;
+
+  posix::syslog << posix::priority::warning
+                << "Instance %2 of provider %1 has exited."_xlate
+                << m_name
+                << int(iter - m_instance_pids.begin())
+                << posix::eom;
+
+  uint16_t running = uint16_t(std::count_if(m_instance_pids.begin(), m_instance_pids.end(),
+                                            [](pid_t instance) noexcept { return instance != 0; }));
+  if(running >= m_quorum) // the job still runs: bring back just this instance
+    respawnInstance(uint16_t(iter - m_instance_pids.begin()));
+  else if(!getPids().empty()) // when nothing is left 'exited' reports it
+    Object::enqueue(quorumLost);
+}
+
+// collect the exit status of a spawned instance as soon as it exits
+void JobContainer::reapSpawned(pid_t pid) noexcept
+{
+  auto iter = std::find(m_spawned.begin(), m_spawned.end(), pid);
+  if(iter != m_spawned.end() &&
+     ::waitpid(pid, nullptr, WNOHANG) != 0) // exited or no longer our child
+    m_spawned.erase(iter);
+}
+
+// collect the exit status of spawned instances that have exited
+void JobContainer::reapSpawned(void) noexcept
+{
+  auto iter = m_spawned.begin();
+  while(iter != m_spawned.end())
+  {
+    if(::waitpid(*iter, nullptr, WNOHANG) != 0) // exited or no longer our child
+      iter = m_spawned.erase(iter);
+    else
+      ++iter;
+  }
+}
+
+// false if the instance must not be started some other way
+bool JobContainer::startInstance(uint16_t instance) noexcept
+{
+  const bool pinned = m_instance_pids.size() > 1;
+  if(m_config.spawn) // argv, envp and credentials were prepared at reload
+  {
+    pid_t pid = spawn_instance(*m_config.spawn, instance);
+    if(pid != posix::error_response)
+    {
+      m_spawned.push_back(pid);
+      m_instance_pids[instance] = pid;
+      JobController::add(posix::getpid(), pid);
+      if(pinned)
+        pin_instance(pid, instance);
+      Object::enqueue_copy(state, "Initilizing"_xlate);
+      return true;
+    }
+    if(!m_config.spawn->direct && errno == EPERM) // the credentials could not be changed: never run it with ours
+    {
+      m_log << "Provider: %1\nField: %2\nError: unable to switch to the configured user and groups\nCause: %3"_xlate
+            << m_name
+            << "/Process/User"
+            << posix::strerror(errno)
+            << posix::eom; // record error
+      return false;
+    }
+    // ChildProcess gets to try (and report the error)
+  }
+
+  m_childprocs[instance].reset(new ChildProcess());
+  ChildProcess* childproc = m_childprocs[instance].get();
+  JobController::add(posix::getpid(), childproc->processId());
+  m_instance_pids[instance] = childproc->processId();
+  if(pinned)
+    pin_instance(childproc->processId(), instance);
+
+  Object::connect(childproc->started, [this](pid_t) noexcept { Object::enqueue_copy(state, "Initilizing"_xlate); });
+  for(auto pair : m_options)
+  {
+    if(pinned && pair.first == "/Process/Arguments")
+      childproc->setOption(pair.first, instance_arguments(pair.second, instance));
+    else
+      childproc->setOption(pair.first, pair.second);
+  }
+
+  if(childproc->invoke())
+  {
+    //display::providerStatus(config, "starting");
+  }
+  return true;
 }
 
-void JobContainer::start(milliseconds_t timeout,
-                         const std::list<std::string>& services,
-                         const std::unordered_map<std::string, std::string>& options) noexcept
+// start a lost instance again in its own slot, backing off like a provider restart
+void JobContainer::respawnInstance(uint16_t instance) noexcept
 {
-  m_childproc.reset(new ChildProcess());
-  JobController::add(posix::getpid(), m_childproc->processId());
+  instance_restart_t& restart = m_instance_restarts[instance];
+  if(restart.stable) // did not run long enough to count as recovered
+    TimerWheel::instance().cancel(restart.stable);
+  restart.stable = 0;
+  if(restart.backoff) // already waiting to restart
+    return;
+
+  if(restart.attempts >= DIRECTOR_RESTART_LIMIT)
+  {
+    posix::syslog << posix::priority::error
+                  << "Instance %2 of provider %1 failed %3 times in a row and will not be restarted."_xlate
+                  << m_name
+                  << int(instance)
+                  << int(restart.attempts)
+                  << posix::eom;
+    return;
+  }
+
+  milliseconds_t delay = restart_backoff(restart.attempts);
+  ++restart.attempts;
+  restart.backoff = TimerWheel::instance().schedule(delay,
+                                                    [this, instance]() noexcept
+                                                    {
+                                                      m_instance_restarts[instance].backoff = 0;
+                                                      if(m_stopping || m_instance_pids[instance]) // no longer wanted
+                                                        return;
+                                                      if(!startInstance(instance) || !m_instance_pids[instance])
+                                                      {
+                                                        respawnInstance(instance); // counts as another failure
+                                                        return;
+                                                      }
+                                                      m_instance_restarts[instance].stable =
+                                                          TimerWheel::instance().schedule(DIRECTOR_RESTART_STABLE,
+                                                                                          [this, instance]() noexcept
+                                                                                          {
+                                                                                            m_instance_restarts[instance].stable = 0;
+                                                                                            m_instance_restarts[instance].attempts = 0;
+                                                                                          });
+                                                    });
+}
+
+void JobContainer::cancelRespawns(void) noexcept
+{
+  for(instance_restart_t& restart : m_instance_restarts)
+  {
+    if(restart.backoff)
+      TimerWheel::instance().cancel(restart.backoff);
+    if(restart.stable)
+      TimerWheel::instance().cancel(restart.stable);
+    restart = instance_restart_t();
+  }
+}
+
+void JobContainer::start(const provider_config_t& config,
+                         const StringPool& names,
+                         const ConfigTable& options) noexcept
+{
+  milliseconds_t timeout = config.start_timeout;
+  uint16_t instances = config.instances;
+  uint16_t quorum = config.quorum;
+
+  if(!instances) // safeguard from bad config value
+    instances = 1;
+  if(!quorum || quorum > instances) // if all instances must be up
+    quorum = instances;
+
+  // each instance provides its own copy of the services
+  std::vector<std::list<std::string>> instance_services(instances);
+  m_services.clear();
+  for(uint16_t instance = 0; instance < instances; ++instance)
+  {
+    for(strid_t service : config.provided_services)
+      instance_services[instance].emplace_back(instances == 1 ? names.str(service) : instance_service(names.str(service), instance));
+    m_services.insert(m_services.end(), instance_services[instance].begin(), instance_services[instance].end());
+  }
 
   Object::disconnect(m_waitstart.event_timeout);
   Object::connect(m_waitstart.event_timeout,
-                  [this, services]() noexcept // cannot guarantee 'services' won't change: copy it
+                  [this]() noexcept
                   {
-                    for(const std::string& service : services) // check all services (if any)
+                    for(const std::string& service : m_services) // check all services (if any)
                       if(!service_exists(service)) // ensure service exists
                         m_log << "Provider: %1\nField: %3\nError: timed out waiting for service to start\nCause: service %2 does not exist."_xlate
                               << m_name
@@ -32,43 +239,53 @@ void JobContainer::start(milliseconds_t timeout,
                     Object::enqueue(startFailure); // job did not start in allotted time :(
                   });
 
-  Object::connect(m_childproc->started, [this](pid_t) noexcept { Object::enqueue_copy(state, "Initilizing"_xlate); });
-  for(auto pair : options)
-    m_childproc->setOption(pair.first, pair.second);
-
-  if(m_childproc->invoke())
-  {
-    //display::providerStatus(config, "starting");
-  }
+  cancelRespawns();
+  m_config = config;
+  m_options = options;
+  m_childprocs.clear();
+  m_childprocs.resize(instances);
+  reapSpawned();
+  m_instance_pids.assign(instances, 0);
+  m_instance_restarts.assign(instances, instance_restart_t());
+  m_quorum = quorum;
+  m_stopping = false;
+  for(uint16_t instance = 0; instance < instances; ++instance)
+    if(!startInstance(instance))
+    {
+      Object::enqueue(startFailure);
+      return;
+    }
 
-  m_waitstart.setServices(services);
+  m_waitstart.setServices(instance_services, quorum);
   if(!timeout) // safeguard from bad config value
     timeout = seconds(20); // 20 second timeout
   m_waitstart.setTimeout(timeout);
 }
 
-void JobContainer::stop(milliseconds_t timeout,
-                        const std::list<std::string>& services,
-                        posix::Signal::EId exit_signal,
-                        const std::string& exit_type) noexcept
+void JobContainer::stop(const provider_config_t& config) noexcept
 {
-  uint32_t exit_type_hash = hash(exit_type);
+  const milliseconds_t timeout = config.exit_timeout;
+  const posix::Signal::EId exit_signal = config.exit_signal;
+  const std::list<std::string>& services = m_services;
+  exit_wait_t exit_wait = config.exit_wait;
+  m_stopping = true; // exits of instances are expected from now on
+  cancelRespawns();
 
-  if(exit_type_hash == "HaltService"_hash && // if halting waits for services to disappear AND
+  if(exit_wait == exit_wait_t::HaltServices && // if halting waits for services to disappear AND
      services.empty()) // no services are provided
-    exit_type_hash = "ProcessTermination"_hash; // switch exit to waiting for the process to stop existing
+    exit_wait = exit_wait_t::ProcessTermination; // switch exit to waiting for the process to stop existing
 
-  switch(exit_type_hash)
+  switch(exit_wait)
   {
 
-    case "AssumeExit"_hash: // just send the signal and assume it exits
+    case exit_wait_t::AssumeExit: // just send the signal and assume it exits
     {
       sendSignal(exit_signal); // send job the signal to exit
       Object::enqueue(stopSuccess); // assume success
       break;
     }
 
-    case "HaltServices"_hash: // Wait for services to disappear and assume it exits
+    case exit_wait_t::HaltServices: // Wait for services to disappear and assume it exits
     {
       Object::disconnect(m_waitexit.event_timeout);
       Object::connect(m_waitexit.event_timeout,
@@ -89,8 +306,7 @@ void JobContainer::stop(milliseconds_t timeout,
       break;
     }
 
-    default: // Unexpected value! Default to waiting for process to stop existing
-    case "ProcessTermination"_hash: // wait for the process to stop existing
+    case exit_wait_t::ProcessTermination: // wait for the process to stop existing
     {
       Object::disconnect(m_waitexit.event_timeout);
       Object::connect(m_waitexit.event_timeout,
@@ -106,8 +322,14 @@ void JobContainer::stop(milliseconds_t timeout,
                         Object::enqueue(stopFailure); // job did not exit in allotted time :(
                       });
 
+      if(getPids().empty()) // if already gone
+      {
+        Object::enqueue(stopSuccess);
+        break;
+      }
+
       m_waitexit.setPids(getPids());
-      m_waitexit.setTimeout(timeout ? timeout : seconds(10)); // start timer (10 seconds if 0 value)
+      m_waitexit.setDeadline(timeout ? timeout : seconds(10)); // exit events end the wait, verify at the deadline (10 seconds if 0 value)
       sendSignal(exit_signal); // send job the signal to exit
       break;
     }
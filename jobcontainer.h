@@ -2,29 +2,56 @@
 #define JOBCONTAINER_H
 
 #include <memory>
+#include <vector>
 
 #include <put/childprocess.h>
 #include <put/cxxutils/syslogstream.h>
 
 #include "jobcontroller.h"
 #include "eventpending.h"
+#include "configtable.h"
+#include "providerconfig.h"
+#include "timerwheel.h"
+
+#ifndef DIRECTOR_RESTART_LIMIT
+#define DIRECTOR_RESTART_LIMIT        5 // restarts in a row before a failing provider (or instance) is given up on
+#endif
+
+#ifndef DIRECTOR_RESTART_BACKOFF
+#define DIRECTOR_RESTART_BACKOFF      500 // milliseconds before the first restart, doubled for each following one
+#endif
+
+#ifndef DIRECTOR_RESTART_BACKOFF_MAX
+#define DIRECTOR_RESTART_BACKOFF_MAX  30000 // longest wait before a restart
+#endif
+
+#ifndef DIRECTOR_RESTART_STABLE
+#define DIRECTOR_RESTART_STABLE       60000 // milliseconds a restarted provider must run to clear its restart count
+#endif
+
+// wait before restart number 'attempts' (counting from zero)
+inline milliseconds_t restart_backoff(uint8_t attempts) noexcept
+{
+  if(attempts >= 16) // long past the longest wait (and the shift stays in range)
+    return DIRECTOR_RESTART_BACKOFF_MAX;
+  milliseconds_t delay = milliseconds_t(DIRECTOR_RESTART_BACKOFF) << attempts;
+  return delay > DIRECTOR_RESTART_BACKOFF_MAX ? milliseconds_t(DIRECTOR_RESTART_BACKOFF_MAX) : delay;
+}
 
 class JobContainer : public JobController
 {
 public:
   JobContainer(const std::string& name) noexcept;
-  ~JobContainer(void) noexcept = default;
+  ~JobContainer(void) noexcept;
 
-  void start(milliseconds_t timeout,
-             const std::list<std::string>& services,
-             const std::unordered_map<std::string, std::string>& options) noexcept;
+  void start(const provider_config_t& config,
+             const StringPool& names, // resolves the service IDs in 'config'
+             const ConfigTable& options) noexcept;
 
-  void stop (milliseconds_t timeout,
-             const std::list<std::string>& services,
-             posix::Signal::EId exit_signal,
-             const std::string& exit_type) noexcept;
+  void stop (const provider_config_t& config) noexcept;
 
   ErrorLogStream log(void) const { return m_log; }
+  const std::list<std::string>& providedServices(void) const noexcept { return m_services; } // instance suffixed services
 
   signal<const char*> state;
 
@@ -34,10 +61,34 @@ public:
   signal<> stopFailure;
   signal<> stopSuccess;
 
+  signal<> quorumLost; // fewer instances than the quorum are left while others still run
+
 private:
-  const std::string& m_name;
+  const std::string m_name;
   ErrorLogStream m_log;
-  std::unique_ptr<ChildProcess> m_childproc;
+  void reapSpawned(pid_t pid) noexcept;
+  void reapSpawned(void) noexcept;
+  void instanceExited(pid_t pid) noexcept;
+  bool startInstance(uint16_t instance) noexcept;
+  void respawnInstance(uint16_t instance) noexcept;
+  void cancelRespawns(void) noexcept;
+
+  struct instance_restart_t
+  {
+    uint8_t attempts = 0; // restarts since the instance last ran long enough
+    TimerWheel::handle_t backoff = 0; // pending restart
+    TimerWheel::handle_t stable = 0; // clears 'attempts' when it fires
+  };
+
+  std::vector<std::unique_ptr<ChildProcess>> m_childprocs; // one per instance
+  std::vector<pid_t> m_spawned; // instances started from the spawn plan (we reap them)
+  std::list<std::string> m_services;
+  std::vector<pid_t> m_instance_pids; // main process of each instance, zero once it has exited
+  std::vector<instance_restart_t> m_instance_restarts; // indexed like m_instance_pids
+  provider_config_t m_config; // kept to start single instances again
+  ConfigTable m_options;
+  uint16_t m_quorum;
+  bool m_stopping;
   ExitPending  m_waitexit;
   StartPending m_waitstart;
 };
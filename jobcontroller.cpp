@@ -13,16 +13,19 @@ void JobController::add(pid_t parent_pid, pid_t child_pid) noexcept
 
     Object::connect(proc.forked, this, &JobController::add);
 
-    Object::connect(proc.exited,
-                    [this](pid_t pid, int rval) noexcept
-                      { remove(pid); if(m_procs.empty()) { Object::enqueue(exited, rval); } });
-
-    Object::connect(proc.killed,
-                    [this](pid_t pid, int rval) noexcept
-                      { remove(pid); if(m_procs.empty()) { Object::enqueue(exited, rval); } });
+    Object::connect(proc.exited, this, &JobController::processGone);
+    Object::connect(proc.killed, this, &JobController::processGone);
   }
 }
 
+void JobController::processGone(pid_t pid, int rval) noexcept
+{
+  remove(pid);
+  Object::enqueue(processExited, pid, posix::error_t(rval));
+  if(m_procs.empty())
+    Object::enqueue(exited, posix::error_t(rval));
+}
+
 void JobController::remove(pid_t pid) noexcept
 {
   auto iter = m_pids.begin();
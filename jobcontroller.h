@@ -19,9 +19,11 @@ public:
 
   bool sendSignal(posix::Signal::EId signum) noexcept;
 
-  signal<posix::error_t> exited; // exit signal with PID and process exit code
+  signal<posix::error_t> exited; // every tracked process has exited, with the exit code of the last one
+  signal<pid_t, posix::error_t> processExited; // one tracked process has exited (or was killed)
   signal<posix::Signal::EId> killed; // killed signal with PID and signal number
 private:
+  void processGone(pid_t pid, int rval) noexcept;
   void remove(pid_t pid) noexcept;
   std::list<std::pair<pid_t, pid_t>> m_pids;
   std::list<ProcessEvent> m_procs;
@@ -10,6 +10,7 @@
 
 // project
 #include "directorcore.h"
+#include "userdatabase.h"
 
 #ifndef DIRECTOR_APP_NAME
 # define DIRECTOR_APP_NAME      "SXdirector"
@@ -23,6 +24,9 @@
 # define DIRECTOR_GROUPNAME     DIRECTOR_USERNAME
 #endif
 
+// POSIX
+#include <sys/stat.h>
+
 #if (defined(__linux__) && KERNEL_VERSION_CODE >= KERNEL_VERSION(2,1,44)) || \
     (defined(__FreeBSD__) && KERNEL_VERSION_CODE >= KERNEL_VERSION(10,2,0))
 # include <sys/prctl.h>
@@ -35,6 +39,35 @@ void exiting(void) noexcept
                 << posix::eom;
 }
 
+// the config image and the prefetch list are written after the switch to the director user
+static void make_cache_directory(void) noexcept
+{
+  UserDatabase& accounts = UserDatabase::instance();
+  uid_t uid = posix::geteuid();
+  gid_t gid = posix::getegid();
+
+  if(::mkdir(DIRECTOR_CACHE_DIR, 0755) != posix::success_response && errno != EEXIST)
+  {
+    posix::syslog << posix::priority::warning
+                  << "Unable to create cache directory %1 : %2"_xlate
+                  << DIRECTOR_CACHE_DIR
+                  << posix::strerror(errno)
+                  << posix::eom;
+    return;
+  }
+
+  if(!accounts.findUser(DIRECTOR_USERNAME, uid, gid)) // Director keeps running as the current user
+    return;
+  accounts.findGroup(DIRECTOR_GROUPNAME, gid); // otherwise the primary group of the user
+  if(::chown(DIRECTOR_CACHE_DIR, uid, gid) != posix::success_response)
+    posix::syslog << posix::priority::warning
+                  << "Unable to give cache directory %1 to user \"%2\" : %3"_xlate
+                  << DIRECTOR_CACHE_DIR
+                  << DIRECTOR_USERNAME
+                  << posix::strerror(errno)
+                  << posix::eom;
+}
+
 //#include "demo.h"
 int main(int argc, char *argv[]) noexcept
 {
@@ -75,6 +108,8 @@ int main(int argc, char *argv[]) noexcept
   }
 #endif
 
+  make_cache_directory(); // before the capability to change file owners is dropped
+
 #if defined(POSIX_DRAFT_1E) // Linux
   if(::prctl(PR_SET_KEEPCAPS, 1) == posix::error_response)
   {
@@ -95,6 +130,7 @@ int main(int argc, char *argv[]) noexcept
   caps.effective
       .set(capflag::kill) // for killing the processes being supervised
       .set(capflag::net_admin) // for reading from the Process Event Connector
+      .set(capflag::sys_ptrace) // for recording the files mapped by providers of other users
       .set(capflag::setuid)
       .set(capflag::setgid);
 
@@ -108,8 +144,14 @@ int main(int argc, char *argv[]) noexcept
                   << posix::eom;
 #endif
 
-  if(posix::strcmp(posix::getgroupname(egid), DIRECTOR_GROUPNAME) && // if current effective group name is NOT what we want AND
-     !posix::setegid(posix::getgroupid(DIRECTOR_GROUPNAME))) // unable to change effective group id
+  UserDatabase& accounts = UserDatabase::instance(); // read from the files: NSS may not be up yet
+  uid_t director_uid = euid;
+  gid_t director_gid = egid;
+  gid_t primary_gid = egid;
+
+  if(accounts.groupName(egid) != DIRECTOR_GROUPNAME && // if current effective group name is NOT what we want AND
+     (!accounts.findGroup(DIRECTOR_GROUPNAME, director_gid) ||
+      !posix::setegid(director_gid))) // unable to change effective group id
   {
     posix::syslog << posix::priority::error
                   << "Director must be launched as group name \"%1\" or have permissions to setegid"_xlate
@@ -118,8 +160,9 @@ int main(int argc, char *argv[]) noexcept
 //    posix::exit(posix::error_t(posix::errc::permission_denied));
   }
 
-  if(posix::strcmp(posix::getusername(euid), DIRECTOR_USERNAME) && // if current effective user name is NOT what we want AND
-     !posix::seteuid(posix::getuserid (DIRECTOR_USERNAME))) // unable to change effective user id
+  if(accounts.userName(euid) != DIRECTOR_USERNAME && // if current effective user name is NOT what we want AND
+     (!accounts.findUser(DIRECTOR_USERNAME, director_uid, primary_gid) ||
+      !posix::seteuid(director_uid))) // unable to change effective user id
   {
     posix::syslog << posix::priority::error
                   << "Director must be launched as user name \"%1\" or have permissions to seteuid"_xlate
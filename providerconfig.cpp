@@ -0,0 +1,70 @@
+#include "providerconfig.h"
+
+// STL
+#include <algorithm>
+#include <cctype>
+
+// PUT
+#include <put/cxxutils/hashing.h>
+
+// Director
+#include "string_helpers.h"
+
+static const std::string& value_of(const ConfigTable& data, const char* key) noexcept
+{
+  static const std::string empty;
+  auto iter = data.find(key);
+  return iter == data.end() ? empty : (*iter).second;
+}
+
+// explode a list value straight into interned IDs (same rules as clean_explode)
+static std::vector<strid_t> intern_list(const std::string& str, StringPool& names) noexcept
+{
+  std::vector<strid_t> ids;
+  std::string item;
+  for(char character : str)
+  {
+    if(character == LIST_DELIM)
+    {
+      if(!item.empty())
+      {
+        ids.push_back(names.intern(item));
+        item.clear();
+      }
+    }
+    else if(std::isgraph(character))
+      item.push_back(character);
+  }
+
+  if(!item.empty())
+    ids.push_back(names.intern(item));
+  return ids;
+}
+
+exit_wait_t decode_exit_wait(const std::string& exit_type) noexcept
+{
+  switch(hash(exit_type))
+  {
+    case "AssumeExit"_hash  : return exit_wait_t::AssumeExit;
+    case "HaltServices"_hash: return exit_wait_t::HaltServices;
+  }
+  return exit_wait_t::ProcessTermination; // unexpected values wait for the process to stop existing
+}
+
+provider_config_t compile_provider_config(const ConfigTable& data, StringPool& names) noexcept
+{
+  provider_config_t config;
+  config.start_timeout      = convert_to_unsigned(value_of(data, "/Process/StartTimeout"), 0);
+  config.exit_timeout       = convert_to_unsigned(value_of(data, "/Exiting/Timeout"), 0);
+  config.exit_signal        = decode_signal_name(value_of(data, "/Exiting/Signal"));
+  config.exit_wait          = decode_exit_wait(value_of(data, "/Exiting/ExitWaitType"));
+  config.instances          = decode_instance_count(value_of(data, "/Process/Instances"));
+  config.quorum             = uint16_t(std::min(convert_to_unsigned(value_of(data, "/Process/InstanceQuorum"), 0), uint32_t(UINT16_MAX)));
+  config.provided_services  = intern_list(value_of(data, "/Process/ProvidedServices"), names);
+  config.active_services    = intern_list(value_of(data, "/Requirements/ActiveServices"), names);
+  config.inactive_services  = intern_list(value_of(data, "/Requirements/InactiveServices"), names);
+  config.active_providers   = intern_list(value_of(data, "/Requirements/ActiveProviders"), names);
+  config.inactive_providers = intern_list(value_of(data, "/Requirements/InactiveProviders"), names);
+  config.spawn              = compile_spawn_plan(data, config.instances);
+  return config;
+}
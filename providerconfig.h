@@ -0,0 +1,47 @@
+#ifndef PROVIDERCONFIG_H
+#define PROVIDERCONFIG_H
+
+// STL
+#include <vector>
+#include <memory>
+
+// PUT
+#include <put/cxxutils/posix_helpers.h>
+
+// Director
+#include "configtable.h"
+#include "stringpool.h"
+#include "spawnplan.h"
+
+// how a provider is considered stopped
+enum class exit_wait_t : uint8_t
+{
+  ProcessTermination, // wait for the process to stop existing
+  HaltServices, // wait for services to disappear and assume it exits
+  AssumeExit, // just send the signal and assume it exits
+};
+
+// provider configuration decoded once per reload so that starting and stopping does no parsing
+struct provider_config_t
+{
+  milliseconds_t start_timeout; // zero selects the default
+  milliseconds_t exit_timeout; // zero selects the default
+  posix::Signal::EId exit_signal;
+  exit_wait_t exit_wait;
+  uint16_t instances;
+  uint16_t quorum; // zero means all instances
+
+  std::vector<strid_t> provided_services;
+  std::vector<strid_t> active_services; // services required to be active
+  std::vector<strid_t> inactive_services; // services required to be inactive
+  std::vector<strid_t> active_providers; // providers required to be active
+  std::vector<strid_t> inactive_providers; // providers required to be inactive
+
+  std::shared_ptr<const spawn_plan_t> spawn; // null when ChildProcess must start it
+};
+
+provider_config_t compile_provider_config(const ConfigTable& data, StringPool& names) noexcept;
+
+exit_wait_t decode_exit_wait(const std::string& exit_type) noexcept;
+
+#endif // PROVIDERCONFIG_H
@@ -0,0 +1,241 @@
+#include "serviceregistry.h"
+
+// PUT
+#include <put/specialized/eventbackend.h>
+#include <put/specialized/mountpoints.h>
+
+// POSIX
+#include <fcntl.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#if defined(__linux__)
+#include <sys/inotify.h>
+#endif
+
+static std::string join_path(const std::string& directory, const char* name) noexcept
+{
+  return directory.empty() ? std::string(name) : directory + '/' + name;
+}
+
+ServiceRegistry& ServiceRegistry::instance(void) noexcept
+{
+  static ServiceRegistry registry;
+  return registry;
+}
+
+ServiceRegistry::ServiceRegistry(void) noexcept
+  : m_fd(posix::invalid_descriptor),
+    m_root(posix::invalid_descriptor)
+{
+}
+
+ServiceRegistry::~ServiceRegistry(void) noexcept
+{
+  stop();
+}
+
+bool ServiceRegistry::exists(const std::string& service) noexcept
+{
+  if(isWatching() || start())
+    return m_services.find(service) != m_services.end();
+
+  if(scfs_path == nullptr && // if SCFS has not been found AND
+     !reinitialize_paths()) // it still can't be found
+    return false;
+  std::string path = scfs_path;
+  path.push_back('/');
+  path.append(service);
+  return !posix::access(path.c_str(), posix::file_exists);
+}
+
+bool ServiceRegistry::start(void) noexcept
+{
+#if defined(__linux__)
+  if(scfs_path == nullptr &&
+     !reinitialize_paths())
+    return false;
+
+  m_root_path = scfs_path;
+  m_root = ::open(m_root_path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  m_fd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if(m_root == posix::error_response ||
+     m_fd == posix::error_response ||
+     !EventBackend::add(m_fd, EventBackend::SimplePollReadFlags,
+                        [this](posix::fd_t, EventBackend::native_flags_t) noexcept { readEvents(); }))
+  {
+    if(m_root != posix::error_response)
+      posix::close(m_root);
+    if(m_fd != posix::error_response)
+      posix::close(m_fd);
+    m_root = m_fd = posix::invalid_descriptor;
+    return false;
+  }
+
+  scan(std::string());
+  if(m_watches.empty()) // the root itself could not be watched
+  {
+    stop();
+    return false;
+  }
+  return true;
+#else
+  return false;
+#endif
+}
+
+void ServiceRegistry::stop(void) noexcept
+{
+  if(m_fd != posix::invalid_descriptor)
+  {
+    EventBackend::remove(m_fd, EventBackend::SimplePollReadFlags);
+    posix::close(m_fd); // removes every watch
+    m_fd = posix::invalid_descriptor;
+  }
+  if(m_root != posix::invalid_descriptor)
+  {
+    posix::close(m_root);
+    m_root = posix::invalid_descriptor;
+  }
+  m_watches.clear();
+  m_services.clear();
+}
+
+// events were lost: start over from the current directory contents
+void ServiceRegistry::rescan(void) noexcept
+{
+#if defined(__linux__)
+  for(const auto& pair : m_watches)
+    ::inotify_rm_watch(m_fd, pair.first);
+#endif
+  m_watches.clear();
+  m_services.clear();
+  scan(std::string());
+}
+
+void ServiceRegistry::scan(const std::string& directory) noexcept
+{
+#if defined(__linux__)
+  // watch before listing so that nothing created in between is missed
+  int wd = ::inotify_add_watch(m_fd,
+                               directory.empty() ? m_root_path.c_str() : (m_root_path + '/' + directory).c_str(),
+                               IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR);
+  if(wd == posix::error_response)
+    return;
+  m_watches[wd] = directory;
+
+  int fd = directory.empty() ?
+             ::dup(m_root) :
+             ::openat(m_root, directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if(fd == posix::error_response)
+    return;
+  DIR* dir = ::fdopendir(fd); // takes ownership of 'fd'
+  if(dir == nullptr)
+  {
+    posix::close(fd);
+    return;
+  }
+
+  while(struct dirent* entry = ::readdir(dir))
+  {
+    if(entry->d_name[0] == '.' &&
+       (!entry->d_name[1] || (entry->d_name[1] == '.' && !entry->d_name[2]))) // skip "." and ".."
+      continue;
+
+    std::string path = join_path(directory, entry->d_name);
+    bool is_directory = entry->d_type == DT_DIR;
+    if(entry->d_type == DT_UNKNOWN) // file system does not report types
+    {
+      struct stat info;
+      is_directory = !::fstatat(::dirfd(dir), entry->d_name, &info, AT_SYMLINK_NOFOLLOW) && S_ISDIR(info.st_mode);
+    }
+
+    m_services.insert(path);
+    if(is_directory)
+      scan(path);
+  }
+  ::closedir(dir);
+#else
+  (void)directory;
+#endif
+}
+
+void ServiceRegistry::forget(const std::string& path) noexcept
+{
+  m_services.erase(path);
+
+  std::string prefix = path + '/';
+  for(auto iter = m_services.begin(); iter != m_services.end(); )
+  {
+    if(!iter->compare(0, prefix.size(), prefix))
+      iter = m_services.erase(iter);
+    else
+      ++iter;
+  }
+
+#if defined(__linux__)
+  for(auto iter = m_watches.begin(); iter != m_watches.end(); ) // a moved directory is watched again under its new name
+  {
+    if(iter->second == path || !iter->second.compare(0, prefix.size(), prefix))
+    {
+      ::inotify_rm_watch(m_fd, iter->first);
+      iter = m_watches.erase(iter);
+    }
+    else
+      ++iter;
+  }
+#endif
+}
+
+void ServiceRegistry::readEvents(void) noexcept
+{
+#if defined(__linux__)
+  alignas(struct inotify_event) char buffer[4096];
+  posix::ssize_t length;
+  bool overflowed = false;
+  while((length = ::read(m_fd, buffer, sizeof(buffer))) > 0)
+  {
+    for(char* pos = buffer; pos < buffer + length; )
+    {
+      const struct inotify_event* event = reinterpret_cast<const struct inotify_event*>(pos);
+      pos += sizeof(struct inotify_event) + event->len;
+
+      if(event->mask & IN_Q_OVERFLOW)
+      {
+        overflowed = true;
+        continue;
+      }
+
+      auto watch = m_watches.find(event->wd);
+      if(watch == m_watches.end()) // removed watch
+        continue;
+
+      if(event->mask & IN_IGNORED) // watched directory is gone
+      {
+        if(watch->second.empty()) // SCFS itself: find it again on the next check
+        {
+          stop();
+          return;
+        }
+        m_watches.erase(watch);
+      }
+      else if(event->len)
+      {
+        std::string path = join_path(watch->second, event->name);
+        if(event->mask & (IN_CREATE | IN_MOVED_TO))
+        {
+          m_services.insert(path);
+          if(event->mask & IN_ISDIR)
+            scan(path); // entries may have been created before the watch
+        }
+        else if(event->mask & (IN_DELETE | IN_MOVED_FROM))
+          forget(path);
+      }
+    }
+  }
+
+  if(overflowed)
+    rescan();
+#endif
+}
@@ -0,0 +1,41 @@
+#ifndef SERVICEREGISTRY_H
+#define SERVICEREGISTRY_H
+
+// STL
+#include <string>
+#include <unordered_set>
+#include <unordered_map>
+
+// PUT
+#include <put/cxxutils/posix_helpers.h>
+
+// Set of the services present in the SCFS tree, kept current with directory notifications
+// so that existence checks are hash lookups.  Falls back on access() when it cannot watch.
+class ServiceRegistry
+{
+public:
+  static ServiceRegistry& instance(void) noexcept;
+
+  bool exists(const std::string& service) noexcept;
+  bool isWatching(void) const noexcept { return m_fd != posix::invalid_descriptor; }
+  posix::size_t size(void) const noexcept { return m_services.size(); }
+
+private:
+  ServiceRegistry(void) noexcept;
+  ~ServiceRegistry(void) noexcept;
+
+  bool start(void) noexcept;
+  void stop(void) noexcept;
+  void rescan(void) noexcept;
+  void scan(const std::string& directory) noexcept; // add a directory, its entries and subdirectories
+  void forget(const std::string& path) noexcept; // remove an entry and everything below it
+  void readEvents(void) noexcept;
+
+  posix::fd_t m_fd; // inotify descriptor
+  posix::fd_t m_root; // SCFS directory, every scan is relative to it
+  std::string m_root_path;
+  std::unordered_map<int, std::string> m_watches; // directory by watch descriptor ("" for the root)
+  std::unordered_set<std::string> m_services; // paths relative to the root
+};
+
+#endif // SERVICEREGISTRY_H
@@ -0,0 +1,77 @@
+#include "snapshot.h"
+
+// POSIX
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+
+// STL
+#include <vector>
+
+static bool read_uint32(const char*& pos, const char* end, uint32_t& value) noexcept
+{
+  if(end - pos < posix::ssize_t(sizeof(uint32_t)))
+    return false;
+  posix::memcpy(&value, pos, sizeof(uint32_t)); // may be unaligned
+  pos += sizeof(uint32_t);
+  return true;
+}
+
+bool read_snapshot(posix::fd_t fd,
+                   uint32_t magic,
+                   uint32_t field_count,
+                   uint32_t& entry_count,
+                   const snapshot_entry_t& entry) noexcept
+{
+  struct stat info;
+  bool ok = false;
+  entry_count = 0;
+
+  if(fd == posix::invalid_descriptor)
+    return false;
+
+  // the server must not be able to shrink or rewrite the file while it is parsed (SIGBUS or changing data)
+#if defined(F_GET_SEALS)
+  int seals = ::fcntl(fd, F_GET_SEALS);
+  if(seals == posix::error_response ||
+     (seals & (F_SEAL_SHRINK | F_SEAL_WRITE)) != (F_SEAL_SHRINK | F_SEAL_WRITE))
+    return false;
+#else
+  return false; // no way to know: the caller syncs in full
+#endif
+
+  if(::fstat(fd, &info) == posix::success_response &&
+     info.st_size >= posix::ssize_t(sizeof(uint32_t) * 3))
+  {
+    void* mapping = ::mmap(nullptr, posix::size_t(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    if(mapping != MAP_FAILED)
+    {
+      const char* pos = static_cast<const char*>(mapping);
+      const char* end = pos + info.st_size;
+      uint32_t file_magic = 0;
+      uint32_t file_fields = 0;
+      std::vector<snapshot_field_t> fields(field_count);
+
+      ok = read_uint32(pos, end, file_magic) && file_magic == magic &&
+           read_uint32(pos, end, file_fields) && file_fields == field_count &&
+           read_uint32(pos, end, entry_count);
+
+      for(uint32_t i = 0; ok && i < entry_count; ++i)
+      {
+        for(snapshot_field_t& field : fields)
+        {
+          ok = read_uint32(pos, end, field.size) &&
+               end - pos >= posix::ssize_t(field.size);
+          if(!ok)
+            break;
+          field.data = pos;
+          pos += field.size;
+        }
+        if(ok)
+          entry(fields.data());
+      }
+      ::munmap(mapping, posix::size_t(info.st_size));
+    }
+  }
+  return ok;
+}
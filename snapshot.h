@@ -0,0 +1,33 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+// STL
+#include <functional>
+
+// PUT
+#include <put/cxxutils/posix_helpers.h>
+
+// Configuration snapshot passed as a memory file descriptor.
+// layout (native byte order):
+//   uint32_t magic, uint32_t fields per entry, uint32_t entry count
+//   each entry: for each field: uint32_t length, followed by that many bytes
+#define CONFIG_SNAPSHOT_MAGIC           0x53584353 // "SXCS": key, value
+#define DIRECTOR_CONFIG_SNAPSHOT_MAGIC  0x53584453 // "SXDS": config, key, value
+
+struct snapshot_field_t
+{
+  const char* data;
+  uint32_t size;
+};
+
+typedef std::function<void(const snapshot_field_t* fields)> snapshot_entry_t;
+
+// maps the snapshot and invokes 'entry' for every entry (the descriptor stays open)
+// returns false if the snapshot is not sealed against shrinking and writing, could not be mapped or is malformed (entries may have been read)
+bool read_snapshot(posix::fd_t fd,
+                   uint32_t magic,
+                   uint32_t field_count,
+                   uint32_t& entry_count,
+                   const snapshot_entry_t& entry) noexcept;
+
+#endif // SNAPSHOT_H
@@ -0,0 +1,230 @@
+#include "spawnplan.h"
+
+// STL
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+
+// Director
+#include "string_helpers.h"
+#include "userdatabase.h"
+
+// POSIX
+#include <grp.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/syscall.h>
+
+extern char** environ;
+
+#ifndef NSIG
+#define NSIG 65
+#endif
+
+// 32-bit ids on the architectures that kept the 16-bit calls
+#if defined(SYS_setresuid32)
+#define DIRECTOR_SYS_SETGROUPS  SYS_setgroups32
+#define DIRECTOR_SYS_SETRESGID  SYS_setresgid32
+#define DIRECTOR_SYS_SETRESUID  SYS_setresuid32
+#else
+#define DIRECTOR_SYS_SETGROUPS  SYS_setgroups
+#define DIRECTOR_SYS_SETRESGID  SYS_setresgid
+#define DIRECTOR_SYS_SETRESUID  SYS_setresuid
+#endif
+
+// options decoded by compile_provider_config, never passed to the process
+static bool director_option(const std::string& key) noexcept
+{
+  return key == "/Process/StartTimeout" ||
+         key == "/Process/Instances" ||
+         key == "/Process/InstanceQuorum" ||
+         key == "/Process/ProvidedServices" ||
+         !key.compare(0, sizeof("/Exiting/") - 1, "/Exiting/") ||
+         !key.compare(0, sizeof("/Requirements/") - 1, "/Requirements/") ||
+         !key.compare(0, sizeof("/Enhancements/") - 1, "/Enhancements/");
+}
+
+// split on whitespace, false if the value needs quoting rules
+static bool split_arguments(const std::string& str, std::vector<std::string>& args) noexcept
+{
+  std::string arg;
+  for(char c : str)
+  {
+    if(c == '"' || c == '\'' || c == '\\')
+      return false;
+    if(std::isspace(c))
+    {
+      if(!arg.empty())
+        args.emplace_back(std::move(arg));
+      arg.clear();
+    }
+    else
+      arg.push_back(c);
+  }
+  if(!arg.empty())
+    args.emplace_back(std::move(arg));
+  return true;
+}
+
+spawn_plan_t::spawn_plan_t(void) noexcept
+  : uid(0),
+    gid(0),
+    direct(true)
+{
+  ::posix_spawnattr_init(&attributes);
+  sigset_t signals;
+  ::sigfillset(&signals);
+  ::posix_spawnattr_setsigdefault(&attributes, &signals);
+  ::sigemptyset(&signals);
+  ::posix_spawnattr_setsigmask(&attributes, &signals);
+  ::posix_spawnattr_setflags(&attributes, POSIX_SPAWN_SETSIGDEF | POSIX_SPAWN_SETSIGMASK);
+}
+
+spawn_plan_t::~spawn_plan_t(void) noexcept
+{
+  ::posix_spawnattr_destroy(&attributes);
+}
+
+std::shared_ptr<const spawn_plan_t> compile_spawn_plan(const ConfigTable& data, uint16_t instances) noexcept
+{
+  std::shared_ptr<spawn_plan_t> plan = std::make_shared<spawn_plan_t>();
+  std::string arguments, user, group;
+
+  for(auto pair : data)
+  {
+    if(pair.first == "/Process/Executable")
+      plan->executable = pair.second;
+    else if(pair.first == "/Process/Arguments")
+      arguments = pair.second;
+    else if(pair.first == "/Process/User")
+      user = pair.second;
+    else if(pair.first == "/Process/Group")
+      group = pair.second;
+    else if(!director_option(pair.first))
+      return nullptr; // leave it to ChildProcess
+  }
+
+  if(plan->executable.empty() || plan->executable.front() != '/') // ChildProcess decides how to find it
+    return nullptr;
+
+  if(!user.empty() || !group.empty())
+  {
+    plan->uid = posix::geteuid();
+    plan->gid = posix::getegid();
+    UserDatabase& accounts = UserDatabase::instance();
+    if(!user.empty() && !accounts.findUser(user, plan->uid, plan->gid))
+      return nullptr; // ChildProcess reports the bad value
+    if(!group.empty() && !accounts.findGroup(group, plan->gid))
+      return nullptr;
+
+    if(!user.empty()) // the groups the user is a member of (by the configured name: accounts may share a uid)
+      plan->groups = accounts.memberGroups(std::all_of(user.begin(), user.end(), [](char c) noexcept { return std::isdigit(c); })
+                                             ? accounts.userName(plan->uid) : user,
+                                           plan->gid);
+    else
+      plan->groups.push_back(plan->gid);
+    plan->direct = false;
+  }
+
+  if(!instances || arguments.find("%i") == std::string::npos) // all instances have the same arguments
+    instances = 1;
+
+  plan->arguments.resize(instances);
+  for(uint16_t instance = 0; instance < instances; ++instance)
+  {
+    std::vector<std::string>& args = plan->arguments[instance];
+    args.push_back(plan->executable);
+    if(!split_arguments(instances > 1 ? instance_arguments(arguments, instance) : arguments, args))
+      return nullptr;
+  }
+
+  // the strings are final: take the pointers
+  plan->argv.resize(instances);
+  for(uint16_t instance = 0; instance < instances; ++instance)
+  {
+    for(std::string& arg : plan->arguments[instance])
+      plan->argv[instance].push_back(&arg.front());
+    plan->argv[instance].push_back(nullptr);
+  }
+
+  for(char** var = environ; var != nullptr && *var != nullptr; ++var)
+    plan->environment.emplace_back(*var);
+  for(std::string& var : plan->environment)
+    plan->envp.push_back(&var.front());
+  plan->envp.push_back(nullptr);
+
+  return plan;
+}
+
+pid_t spawn_instance(const spawn_plan_t& plan, uint16_t instance) noexcept
+{
+  pid_t pid = posix::error_response;
+  char* const* argv = plan.instanceArgv(instance);
+
+  if(plan.direct)
+  {
+    int rval = ::posix_spawn(&pid, plan.executable.c_str(), nullptr, &plan.attributes, argv, plan.envp.data());
+    if(rval != posix::success_response)
+    {
+      errno = rval;
+      return posix::error_response;
+    }
+    return pid;
+  }
+
+  // the child shares our memory until it calls exec: it may only make system calls
+  volatile int child_error = 0;
+  sigset_t all_signals, old_signals;
+  ::sigfillset(&all_signals);
+  ::pthread_sigmask(SIG_SETMASK, &all_signals, &old_signals); // no handler may run in the child
+
+  pid = ::vfork();
+  if(pid == 0)
+  {
+    struct sigaction action;
+    for(int signum = 1; signum < NSIG; ++signum) // our handlers mean nothing to the child
+      if(::sigaction(signum, nullptr, &action) == posix::success_response &&
+         action.sa_handler != SIG_DFL &&
+         action.sa_handler != SIG_IGN)
+      {
+        action.sa_handler = SIG_DFL;
+        ::sigaction(signum, &action, nullptr);
+      }
+
+    sigset_t no_signals;
+    ::sigemptyset(&no_signals);
+
+    // raw system calls: the libc wrappers signal every thread of the shared process to change its ids too
+    // always replace the supplementary groups: ours must not leak to the provider (CAP_SETGID is kept, not euid 0)
+    if(::syscall(DIRECTOR_SYS_SETGROUPS, plan.groups.size(), plan.groups.data()) == posix::error_response ||
+       ::syscall(DIRECTOR_SYS_SETRESGID, plan.gid, plan.gid, plan.gid) == posix::error_response ||
+       ::syscall(DIRECTOR_SYS_SETRESUID, plan.uid, plan.uid, plan.uid) == posix::error_response)
+      child_error = errno;
+    else
+    {
+      ::sigprocmask(SIG_SETMASK, &no_signals, nullptr);
+      ::execve(plan.executable.c_str(), argv, plan.envp.data());
+      child_error = errno;
+    }
+    ::_exit(127);
+  }
+
+  int saved_error = errno;
+  ::pthread_sigmask(SIG_SETMASK, &old_signals, nullptr);
+
+  if(pid == posix::error_response)
+  {
+    errno = saved_error;
+    return posix::error_response;
+  }
+
+  if(child_error) // the child has already exited
+  {
+    saved_error = child_error;
+    ::waitpid(pid, nullptr, 0);
+    errno = saved_error;
+    return posix::error_response;
+  }
+  return pid;
+}
@@ -0,0 +1,51 @@
+#ifndef SPAWNPLAN_H
+#define SPAWNPLAN_H
+
+// STL
+#include <string>
+#include <vector>
+#include <memory>
+
+// PUT
+#include <put/cxxutils/posix_helpers.h>
+
+// Director
+#include "configtable.h"
+
+// POSIX
+#include <spawn.h>
+#include <sys/types.h>
+
+// Everything needed to start a provider, decoded once per reload.
+// Spawning only reads the plan: nothing is allocated between the fork and the exec.
+struct spawn_plan_t
+{
+  spawn_plan_t(void) noexcept;
+  ~spawn_plan_t(void) noexcept;
+  spawn_plan_t(const spawn_plan_t&) = delete;
+  spawn_plan_t& operator =(const spawn_plan_t&) = delete;
+
+  std::string executable; // absolute path
+  std::vector<std::vector<std::string>> arguments; // argv of each instance (one entry when all instances share it)
+  std::vector<std::vector<char*>> argv; // null terminated pointers into 'arguments'
+  std::vector<std::string> environment; // the director's environment at reload
+  std::vector<char*> envp;
+
+  uid_t uid; // only used when 'direct' is false
+  gid_t gid;
+  std::vector<gid_t> groups; // supplementary groups (only when the director may set them)
+
+  bool direct; // no credentials to change: posix_spawn() is enough
+  posix_spawnattr_t attributes; // default signal handlers and an empty signal mask
+
+  char* const* instanceArgv(uint16_t instance) const noexcept
+    { return argv[argv.size() > 1 ? instance : 0].data(); }
+};
+
+// null when the config uses options only ChildProcess handles
+std::shared_ptr<const spawn_plan_t> compile_spawn_plan(const ConfigTable& data, uint16_t instances) noexcept;
+
+// starts one instance, returns the PID or posix::error_response (errno is set)
+pid_t spawn_instance(const spawn_plan_t& plan, uint16_t instance) noexcept;
+
+#endif // SPAWNPLAN_H
@@ -1,9 +1,15 @@
 #include "string_helpers.h"
 
+// POSIX
+#include <unistd.h>
+
 // POSIX++
 #include <cstring>
 #include <climits>
 
+// STL
+#include <algorithm>
+
 // PUT
 #include <put/cxxutils/hashing.h>
 
@@ -47,6 +53,51 @@ int16_t convert_to_runlevel(const std::string& str, int16_t invalid_value)
 }
 
 
+uint32_t convert_to_unsigned(const std::string& str, uint32_t invalid_value) noexcept
+{
+  uint64_t value = 0;
+  if(str.empty())
+    return invalid_value;
+  for(char c : str) // test each character to ensure this is a positive integer
+  {
+    if(!posix::isdigit(c))
+      return invalid_value;
+    value = (value * 10) + uint64_t(c - '0');
+    if(value > UINT32_MAX)
+      return invalid_value;
+  }
+  return uint32_t(value);
+}
+
+
+uint16_t decode_instance_count(const std::string& instances) noexcept
+{
+  if(instances == "ncpu")
+  {
+    long cpu_count = ::sysconf(_SC_NPROCESSORS_ONLN);
+    return cpu_count > 0 ? uint16_t(std::min(cpu_count, long(UINT16_MAX))) : 1;
+  }
+  uint32_t count = convert_to_unsigned(instances, 1);
+  return count ? uint16_t(std::min(count, uint32_t(UINT16_MAX))) : 1;
+}
+
+
+std::string instance_arguments(const std::string& arguments, uint16_t instance) noexcept
+{
+  const std::string number = std::to_string(instance);
+  std::string result;
+  result.reserve(arguments.size());
+  for(std::string::size_type pos = 0; pos < arguments.size(); ++pos)
+  {
+    if(arguments[pos] == '%' && pos + 1 < arguments.size() && arguments[pos + 1] == 'i')
+      { result.append(number); ++pos; }
+    else
+      result.push_back(arguments[pos]);
+  }
+  return result;
+}
+
+
 posix::Signal::EId decode_signal_name(const std::string& signal_name) noexcept
 {
   switch(hash(signal_name))
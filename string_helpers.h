@@ -18,6 +18,14 @@ std::list<std::string> clean_explode(const std::string& str, char delim) noexcep
 
 int16_t convert_to_runlevel(const std::string& str, int16_t invalid_value);
 
+uint32_t convert_to_unsigned(const std::string& str, uint32_t invalid_value) noexcept;
+
+// number of instances from a value that is either a positive integer or "ncpu"
+uint16_t decode_instance_count(const std::string& instances) noexcept;
+
+// replace every "%i" in the argument template with the instance number
+std::string instance_arguments(const std::string& arguments, uint16_t instance) noexcept;
+
 posix::Signal::EId decode_signal_name(const std::string& signal_name) noexcept;
 
 
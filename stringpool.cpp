@@ -0,0 +1,42 @@
+#include "stringpool.h"
+
+StringPool::strid_t StringPool::intern(const std::string& str) noexcept
+{
+  auto rval = m_ids.emplace(str, strid_t(m_strings.size()));
+  if(rval.second) // if newly added
+    m_strings.push_back(&rval.first->first);
+  return rval.first->second;
+}
+
+StringPool::strid_t StringPool::intern(std::string&& str) noexcept
+{
+  auto iter = m_ids.find(str);
+  if(iter != m_ids.end())
+    return iter->second;
+  iter = m_ids.emplace(std::move(str), strid_t(m_strings.size())).first;
+  m_strings.push_back(&iter->first);
+  return iter->second;
+}
+
+StringPool::strid_t StringPool::find(const std::string& str) const noexcept
+{
+  auto iter = m_ids.find(str);
+  return iter == m_ids.end() ? invalid_id : iter->second;
+}
+
+void StringPool::clear(void) noexcept
+{
+  m_strings.clear();
+  m_ids.clear();
+}
+
+size_t StringPool::bytes(void) const noexcept
+{
+  constexpr size_t node_bytes = sizeof(void*) * 2 + sizeof(std::pair<const std::string, strid_t>); // hash node
+  size_t total = sizeof(StringPool) +
+                 m_ids.bucket_count() * sizeof(void*) +
+                 m_strings.capacity() * sizeof(const std::string*);
+  for(const std::string* str : m_strings)
+    total += node_bytes + (str->capacity() > 15 ? str->capacity() + 1 : 0);
+  return total;
+}
@@ -0,0 +1,37 @@
+#ifndef STRINGPOOL_H
+#define STRINGPOOL_H
+
+// STL
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+// PUT
+#include <put/cxxutils/posix_helpers.h>
+
+// interns strings so that each distinct string is stored once and referred to by a small ID
+class StringPool
+{
+public:
+  typedef uint32_t strid_t;
+  constexpr static strid_t invalid_id = UINT32_MAX;
+
+  strid_t intern(const std::string& str) noexcept;
+  strid_t intern(std::string&& str) noexcept; // moves 'str' into the pool if it is new
+  strid_t find(const std::string& str) const noexcept; // invalid_id if not interned
+
+  const std::string& str(strid_t id) const noexcept { return *m_strings[id]; }
+  size_t size(void) const noexcept { return m_strings.size(); }
+
+  void clear(void) noexcept;
+
+  size_t bytes(void) const noexcept; // estimated memory used
+
+private:
+  std::unordered_map<std::string, strid_t> m_ids;
+  std::vector<const std::string*> m_strings; // points into the (node stable) keys of m_ids
+};
+
+typedef StringPool::strid_t strid_t;
+
+#endif // STRINGPOOL_H
@@ -51,26 +51,67 @@ SOURCES += main.cpp \
     directorcore.cpp \
     directorconfigclient.cpp \
     configclient.cpp \
+    configimage.cpp \
+    configloader.cpp \
+    configtable.cpp \
+    configwatcher.cpp \
     jobcontroller.cpp \
     jobcontainer.cpp \
+    providerconfig.cpp \
     dependencysolver.cpp \
+    descriptorstore.cpp \
     eventpending.cpp \
+    bootprefetch.cpp \
     servicecheck.cpp \
-    string_helpers.cpp
+    serviceregistry.cpp \
+    snapshot.cpp \
+    spawnplan.cpp \
+    stringpool.cpp \
+    string_helpers.cpp \
+    timerwheel.cpp \
+    userdatabase.cpp \
+    workerpool.cpp
 
 units:SOURCES += \
     units/jobcontainer_unit.cpp \
-    units/process_control_unit.cpp
+    units/restartorder_unit.cpp \
+    units/instancerestart_unit.cpp \
+    units/process_control_unit.cpp \
+    units/mockconfig_server.cpp \
+    units/configsync_bench.cpp
+
+units:HEADERS += \
+    units/mockconfigserver.h
+
+tools:SOURCES += \
+    tools/configimage_tool.cpp
 
 HEADERS += \
     directorcore.h \
     directorconfigclient.h \
     configclient.h \
+    configimage.h \
+    configloader.h \
+    configwatcher.h \
+    changeset.h \
+    configmap.h \
+    configsnapshot.h \
+    configtable.h \
     jobcontroller.h \
     jobcontainer.h \
+    providerconfig.h \
     dependencysolver.h \
+    descriptorstore.h \
     eventpending.h \
+    bootprefetch.h \
     servicecheck.h \
-    string_helpers.h
+    serviceregistry.h \
+    snapshot.h \
+    spawnplan.h \
+    stringpool.h \
+    string_helpers.h \
+    timerwheel.h \
+    userdatabase.h \
+    workerpool.h
 
 include(put/put.pri)
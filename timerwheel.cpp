@@ -0,0 +1,244 @@
+#include "timerwheel.h"
+
+// POSIX
+#include <time.h>
+
+enum : TimerWheel::tick_t
+{
+  level0_bits = 8,
+  level1_bits = 6,
+  level2_bits = 6,
+  level0_mask = (1 << level0_bits) - 1,
+  level1_mask = (1 << level1_bits) - 1,
+  level2_mask = (1 << level2_bits) - 1,
+  level1_shift = level0_bits,
+  level2_shift = level0_bits + level1_bits,
+  level0_span = TimerWheel::tick_t(1) << level1_shift, // ticks covered by level 0
+  level1_span = TimerWheel::tick_t(1) << level2_shift, // ticks covered by levels 0 and 1
+  level2_span = TimerWheel::tick_t(1) << (level2_shift + level2_bits), // ticks covered by all levels
+  ticks_per_second = 1000 / TIMERWHEEL_RESOLUTION,
+};
+
+static uint64_t monotonic_milliseconds(void) noexcept
+{
+  struct timespec ts;
+  ::clock_gettime(CLOCK_MONOTONIC, &ts);
+  return uint64_t(ts.tv_sec) * 1000 + uint64_t(ts.tv_nsec) / 1000000;
+}
+
+TimerWheel& TimerWheel::instance(void) noexcept
+{
+  static TimerWheel wheel;
+  return wheel;
+}
+
+TimerWheel::TimerWheel(void) noexcept
+  : m_next_handle(0),
+    m_current_tick(now()),
+    m_armed_tick(0),
+    m_wakeups(0),
+    m_second_start(m_current_tick),
+    m_second_wakeups(0),
+    m_last_second_wakeups(0)
+{
+  m_level_count.fill(0);
+  Object::connect(m_timer.expired, this, &TimerWheel::expired);
+}
+
+TimerWheel::tick_t TimerWheel::now(void) noexcept
+{
+  return monotonic_milliseconds() / TIMERWHEEL_RESOLUTION;
+}
+
+TimerWheel::handle_t TimerWheel::schedule(milliseconds_t delay, callback_t callback) noexcept
+{
+  if(m_entries.empty()) // nothing pending: the wheel can skip ahead for free
+    m_current_tick = now();
+
+  handle_t handle = ++m_next_handle;
+  entry_t& entry = m_entries[handle];
+  entry.deadline = (monotonic_milliseconds() + delay + TIMERWHEEL_RESOLUTION - 1) / TIMERWHEEL_RESOLUTION; // round up into the next slot
+  if(entry.deadline <= m_current_tick) // never schedule into a slot that was already processed
+    entry.deadline = m_current_tick + 1;
+  entry.callback = callback;
+  entry.slot = nullptr;
+  insert(handle, entry);
+  rearm();
+  return handle;
+}
+
+void TimerWheel::cancel(handle_t handle) noexcept
+{
+  auto iter = m_entries.find(handle);
+  if(iter != m_entries.end())
+  {
+    unlink(iter->second);
+    m_entries.erase(iter);
+    if(m_entries.empty()) // if nothing is pending
+      rearm(); // stop waking up
+  }
+}
+
+void TimerWheel::insert(handle_t handle, entry_t& entry) noexcept
+{
+  tick_t delta = entry.deadline - m_current_tick;
+  slot_t* slot = nullptr;
+  if(delta < level0_span)
+  {
+    entry.level = 0;
+    slot = &m_level0[entry.deadline & level0_mask];
+  }
+  else if(delta < level1_span)
+  {
+    entry.level = 1;
+    slot = &m_level1[(entry.deadline >> level1_shift) & level1_mask];
+  }
+  else if(delta < level2_span)
+  {
+    entry.level = 2;
+    slot = &m_level2[(entry.deadline >> level2_shift) & level2_mask];
+  }
+  else // beyond the wheel: park in the furthest slot and reinsert when it cascades
+  {
+    entry.level = 2;
+    slot = &m_level2[((m_current_tick >> level2_shift) - 1) & level2_mask];
+  }
+  ++m_level_count[entry.level];
+  entry.slot = slot;
+  entry.position = slot->insert(slot->end(), handle);
+}
+
+void TimerWheel::unlink(entry_t& entry) noexcept
+{
+  if(entry.slot != nullptr)
+  {
+    entry.slot->erase(entry.position);
+    --m_level_count[entry.level];
+    entry.slot = nullptr;
+  }
+}
+
+// move every entry of a higher level slot down to where it belongs now
+void TimerWheel::cascade(slot_t& slot, std::list<handle_t>& due) noexcept
+{
+  slot_t moving;
+  moving.swap(slot);
+  for(handle_t handle : moving)
+  {
+    entry_t& entry = m_entries.find(handle)->second;
+    --m_level_count[entry.level];
+    entry.slot = nullptr;
+    if(entry.deadline <= m_current_tick)
+      due.push_back(handle);
+    else
+      insert(handle, entry);
+  }
+}
+
+// the next tick that has work: an occupied level 0 slot or a cascade of an occupied higher slot
+TimerWheel::tick_t TimerWheel::nextExpiry(void) const noexcept
+{
+  tick_t next = 0;
+  if(m_level_count[0])
+    for(tick_t tick = m_current_tick + 1; tick <= m_current_tick + level0_span; ++tick)
+      if(!m_level0[tick & level0_mask].empty())
+        { next = tick; break; }
+
+  if(m_level_count[1] || m_level_count[2])
+    for(tick_t block = (m_current_tick >> level1_shift) + 1; block <= (m_current_tick >> level1_shift) + level1_mask + 1; ++block)
+    {
+      tick_t tick = block << level1_shift;
+      if(next && next < tick) // a level 0 slot comes first
+        return next;
+      if(!m_level1[block & level1_mask].empty() ||
+         (!(block & level1_mask) && !m_level2[(tick >> level2_shift) & level2_mask].empty()))
+        return tick;
+    }
+
+  if(next)
+    return next;
+
+  for(tick_t block = (m_current_tick >> level2_shift) + 1; block <= (m_current_tick >> level2_shift) + level2_mask + 1; ++block)
+    if(!m_level2[block & level2_mask].empty())
+      return block << level2_shift;
+
+  return m_current_tick + 1; // should not happen
+}
+
+void TimerWheel::rearm(void) noexcept
+{
+  if(m_entries.empty()) // zero wakeups when nothing is pending
+  {
+    if(m_armed_tick)
+      m_timer.stop();
+    m_armed_tick = 0;
+    return;
+  }
+
+  tick_t next = nextExpiry();
+  if(next == m_armed_tick) // already waiting for this tick
+    return;
+
+  uint64_t current = monotonic_milliseconds();
+  uint64_t target = next * TIMERWHEEL_RESOLUTION;
+  milliseconds_t delay = target > current ? milliseconds_t(target - current) : 1;
+  m_armed_tick = next;
+  m_timer.start(delay, false);
+}
+
+void TimerWheel::expired(void) noexcept
+{
+  const tick_t target = now();
+  std::list<handle_t> due;
+
+  m_armed_tick = 0;
+  ++m_wakeups;
+  if(target - m_second_start >= ticks_per_second) // start a new one second window
+  {
+    m_last_second_wakeups = target - m_second_start < 2 * ticks_per_second ? m_second_wakeups : 0;
+    m_second_start = target;
+    m_second_wakeups = 0;
+  }
+  ++m_second_wakeups;
+
+  while(m_current_tick < target)
+  {
+    if(!m_level_count[0]) // nothing in level 0: skip to the end of its rotation
+    {
+      tick_t last = m_current_tick | level0_mask;
+      if(last > target)
+        last = target;
+      if(last > m_current_tick)
+      {
+        m_current_tick = last;
+        continue;
+      }
+    }
+
+    ++m_current_tick;
+    if(!(m_current_tick & level0_mask)) // level 0 wrapped
+    {
+      if(!((m_current_tick >> level1_shift) & level1_mask)) // level 1 wrapped
+        cascade(m_level2[(m_current_tick >> level2_shift) & level2_mask], due);
+      cascade(m_level1[(m_current_tick >> level1_shift) & level1_mask], due);
+    }
+
+    slot_t& slot = m_level0[m_current_tick & level0_mask];
+    m_level_count[0] -= slot.size();
+    for(handle_t handle : slot)
+      m_entries.find(handle)->second.slot = nullptr;
+    due.splice(due.end(), slot);
+  }
+
+  for(handle_t handle : due)
+  {
+    auto iter = m_entries.find(handle);
+    if(iter == m_entries.end()) // canceled by an earlier callback
+      continue;
+    callback_t callback = iter->second.callback;
+    m_entries.erase(iter);
+    callback();
+  }
+
+  rearm();
+}
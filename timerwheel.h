@@ -0,0 +1,74 @@
+#ifndef TIMERWHEEL_H
+#define TIMERWHEEL_H
+
+// STL
+#include <array>
+#include <list>
+#include <unordered_map>
+#include <functional>
+
+// PUT
+#include <put/object.h>
+#include <put/specialized/timerevent.h>
+
+#ifndef TIMERWHEEL_RESOLUTION
+#define TIMERWHEEL_RESOLUTION   10 // milliseconds per tick (coalescing slack)
+#endif
+
+// one timer shared by every pending event: three levels of 256, 64 and 64 slots
+class TimerWheel : public Object
+{
+public:
+  typedef uint64_t handle_t; // zero is never a valid handle
+  typedef uint64_t tick_t;
+  typedef std::function<void(void)> callback_t;
+
+  static TimerWheel& instance(void) noexcept;
+
+  handle_t schedule(milliseconds_t delay, callback_t callback) noexcept;
+  void cancel(handle_t handle) noexcept;
+
+  bool empty(void) const noexcept { return m_entries.empty(); }
+  uint64_t wakeups(void) const noexcept { return m_wakeups; } // total number of timer expirations
+  uint32_t wakeupsPerSecond(void) const noexcept { return m_last_second_wakeups; } // expirations during the last whole second
+
+private:
+  TimerWheel(void) noexcept;
+
+  typedef std::list<handle_t> slot_t;
+
+  struct entry_t
+  {
+    tick_t deadline;
+    callback_t callback;
+    uint8_t level;
+    slot_t* slot; // null when due
+    slot_t::iterator position;
+  };
+
+  static tick_t now(void) noexcept;
+  void insert(handle_t handle, entry_t& entry) noexcept;
+  void unlink(entry_t& entry) noexcept;
+  void cascade(slot_t& slot, std::list<handle_t>& due) noexcept;
+  tick_t nextExpiry(void) const noexcept;
+  void rearm(void) noexcept;
+  void expired(void) noexcept;
+
+  std::array<slot_t, 256> m_level0;
+  std::array<slot_t, 64> m_level1;
+  std::array<slot_t, 64> m_level2;
+  std::array<posix::size_t, 3> m_level_count;
+
+  std::unordered_map<handle_t, entry_t> m_entries;
+  handle_t m_next_handle;
+  tick_t m_current_tick;
+  tick_t m_armed_tick; // zero when the timer is stopped
+  TimerEvent m_timer;
+
+  uint64_t m_wakeups;
+  tick_t m_second_start;
+  uint32_t m_second_wakeups;
+  uint32_t m_last_second_wakeups;
+};
+
+#endif // TIMERWHEEL_H
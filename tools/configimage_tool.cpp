@@ -0,0 +1,42 @@
+// PUT
+#include <put/cxxutils/posix_helpers.h>
+#include <put/cxxutils/vterm.h>
+
+// Director
+#include "../directorconfigclient.h"
+#include "../configloader.h"
+#include "../configimage.h"
+
+#define TOOL_NAME "configimage"
+
+// compile the provider configuration directory into the image the director maps at startup
+// usage: configimage [config directory] [image path]
+int main(int argc, char *argv[]) noexcept
+{
+  const char* directory = argc > 1 ? argv[1] : DIRECTOR_CONFIG_DIR;
+  const char* image     = argc > 2 ? argv[2] : DIRECTOR_CONFIG_IMAGE;
+
+  config_image_stamp_t stamp;
+  if(!config_source_stamp(directory, stamp))
+  {
+    terminal::write("%s: unable to read directory '%s': %s\n", TOOL_NAME, directory, posix::strerror(errno));
+    return EXIT_FAILURE;
+  }
+
+  ConfigDirectoryLoader loader;
+  std::unordered_map<std::string, configmap_t> configs;
+  if(!loader.load(directory, configs))
+  {
+    terminal::write("%s: unable to load configuration files from '%s'\n", TOOL_NAME, directory);
+    return EXIT_FAILURE;
+  }
+
+  if(!write_config_image(image, 0, 0, 0, stamp, configs))
+  {
+    terminal::write("%s: unable to write image '%s': %s\n", TOOL_NAME, image, posix::strerror(errno));
+    return EXIT_FAILURE;
+  }
+
+  terminal::write("%s: compiled %u configuration files into '%s'\n", TOOL_NAME, unsigned(configs.size()), image);
+  return EXIT_SUCCESS;
+}
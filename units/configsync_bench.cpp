@@ -0,0 +1,257 @@
+#include <put/application.h>
+#include <put/object.h>
+#include <put/cxxutils/vterm.h>
+#include <put/cxxutils/posix_helpers.h>
+#include <put/specialized/eventbackend.h>
+
+#include <algorithm>
+#include <functional>
+#include <vector>
+#include <string>
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "mockconfigserver.h"
+#include "../configclient.h"
+#include "../directorconfigclient.h"
+#include "../timerwheel.h"
+
+#define UNIT_NAME "configsync_bench"
+
+// usage: configsync_bench.elf [director|io] [keys] [configs] [changes] [interval ms]
+// A forked mock server holds 'keys' values.  Once the client is synchronized the server
+// changes one value every 'interval' milliseconds, 'changes' times.  Each value is the
+// time it was sent so that the client can measure the latency of every change set.
+
+static uint64_t monotonic_nanoseconds(void) noexcept
+{
+  struct timespec ts;
+  ::clock_gettime(CLOCK_MONOTONIC, &ts);
+  return uint64_t(ts.tv_sec) * 1000000000 + uint64_t(ts.tv_nsec);
+}
+
+static long max_rss_kb(void) noexcept
+{
+  struct rusage usage;
+  ::getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss;
+}
+
+static uint32_t argument(int argc, char* argv[], int index, uint32_t fallback) noexcept
+{
+  return argc > index ? uint32_t(::strtoul(argv[index], nullptr, 10)) : fallback;
+}
+
+// child: serve the data and send changes once the parent says go (EOF ends the server)
+static int serve(MockConfigServer::protocol_t protocol, const std::string& socket_path,
+                 uint32_t keys, uint32_t configs, uint32_t changes, uint32_t interval,
+                 posix::fd_t ready, posix::fd_t go) noexcept
+{
+  Application app;
+  MockConfigServer server(protocol, socket_path);
+  server.populate(keys, configs);
+
+  char status = server.isBound() ? 1 : 0;
+  bool told = ::write(ready, &status, 1) == 1; // the parent gives up without it
+  ::close(ready);
+  if(!status || !told)
+    return EXIT_FAILURE;
+
+  uint32_t sent = 0;
+  std::function<void(void)> send_change;
+  send_change = [&server, &sent, &send_change, changes, interval, protocol]() noexcept
+  {
+    server.set(protocol == MockConfigServer::protocol_t::Director ? "provider0" : "",
+               "/Settings/Bench",
+               std::to_string(monotonic_nanoseconds()));
+    server.commit();
+    if(++sent < changes)
+      TimerWheel::instance().schedule(interval, send_change);
+  };
+
+  EventBackend::add(go, EventBackend::SimplePollReadFlags,
+                    [&send_change, changes, go](posix::fd_t, EventBackend::native_flags_t) noexcept
+                    {
+                      char byte;
+                      if(::read(go, &byte, 1) == 1 && changes)
+                        send_change();
+                      else // the benchmark is over
+                      {
+                        EventBackend::remove(go, EventBackend::SimplePollReadFlags);
+                        Application::quit(EXIT_SUCCESS);
+                      }
+                    });
+  int result = app.exec();
+  if(server.writeFailures()) // the client missed messages: its numbers mean nothing
+  {
+    terminal::write("%s - %s: %llu messages could not be sent to the client\n",
+                    UNIT_NAME, "FAILURE", (unsigned long long)server.writeFailures());
+    return EXIT_FAILURE;
+  }
+  return result;
+}
+
+// parent: time the sync, then the latency of every change set
+template<typename client_type>
+static int measure(Application& app, client_type& client,
+                   uint32_t changes, uint32_t interval, posix::fd_t go,
+                   std::function<const std::string&(void)> sent_value,
+                   std::function<void(void)> report_memory) noexcept
+{
+  uint64_t start = monotonic_nanoseconds();
+  long rss_before = max_rss_kb();
+  std::vector<uint64_t> latencies;
+  latencies.reserve(changes);
+
+  auto finish = [&latencies, go]() noexcept
+  {
+    ::close(go); // ends the server
+    if(!latencies.empty())
+    {
+      std::sort(latencies.begin(), latencies.end());
+      uint64_t total = 0;
+      for(uint64_t latency : latencies)
+        total += latency;
+      terminal::write("%s - change sets: %zu  latency (us) min %llu  avg %llu  p50 %llu  p99 %llu  max %llu\n",
+                      UNIT_NAME, latencies.size(),
+                      (unsigned long long)(latencies.front() / 1000),
+                      (unsigned long long)(total / latencies.size() / 1000),
+                      (unsigned long long)(latencies[latencies.size() / 2] / 1000),
+                      (unsigned long long)(latencies[latencies.size() * 99 / 100] / 1000),
+                      (unsigned long long)(latencies.back() / 1000));
+    }
+    Application::quit(EXIT_SUCCESS);
+  };
+
+  Object::connect(client.synchronized,
+                  [&client, &report_memory, &finish, start, rss_before, changes, go]() noexcept
+                  {
+                    terminal::write("%s - sync: %llu us  max RSS %ld kB (+%ld kB)\n",
+                                    UNIT_NAME,
+                                    (unsigned long long)((monotonic_nanoseconds() - start) / 1000),
+                                    max_rss_kb(), max_rss_kb() - rss_before);
+                    report_memory();
+                    client.takeChanges();
+                    char byte = 1;
+                    if(!changes)
+                      finish();
+                    else if(::write(go, &byte, 1) != 1) // tell the server to start changing values
+                      Application::quit(EXIT_FAILURE);
+                  });
+
+  Object::connect(client.updated,
+                  [&client, &latencies, &finish, &sent_value, changes]() noexcept
+                  {
+                    uint64_t now = monotonic_nanoseconds();
+                    client.takeChanges();
+                    const std::string& sent = sent_value();
+                    if(sent.empty())
+                      return;
+                    latencies.push_back(now - std::strtoull(sent.c_str(), nullptr, 10));
+                    if(latencies.size() == changes)
+                      finish();
+                  });
+
+  TimerWheel::instance().schedule(10000 + milliseconds_t(changes) * interval * 2, // generous deadline
+                                  []() noexcept
+                                  {
+                                    terminal::write("%s - %s: timed out\n", UNIT_NAME, "FAILURE");
+                                    Application::quit(EXIT_FAILURE);
+                                  });
+  return app.exec();
+}
+
+int main(int argc, char *argv[]) noexcept
+{
+  bool director   = argc <= 1 || std::string(argv[1]) != "io";
+  uint32_t keys     = argument(argc, argv, 2, 10000);
+  uint32_t configs  = argument(argc, argv, 3, 100);
+  uint32_t changes  = argument(argc, argv, 4, 1000);
+  uint32_t interval = argument(argc, argv, 5, 10);
+
+  char directory[] = "/tmp/" UNIT_NAME ".XXXXXX";
+  if(::mkdtemp(directory) == nullptr)
+  {
+    terminal::write("%s - %s: unable to create a temporary directory\n", UNIT_NAME, "FAILURE");
+    return EXIT_FAILURE;
+  }
+  std::string socket_path = std::string(directory) + (director ? "/director" : "/io");
+  std::string image_path = std::string(directory) + "/config.image";
+
+  int ready[2], go[2];
+  if(::pipe(ready) || ::pipe(go))
+    return EXIT_FAILURE;
+
+  pid_t server = ::fork();
+  if(server == 0)
+  {
+    ::close(ready[0]);
+    ::close(go[1]);
+    ::_exit(serve(director ? MockConfigServer::protocol_t::Director : MockConfigServer::protocol_t::Io,
+                  socket_path, keys, configs, changes, interval, ready[1], go[0]));
+  }
+  ::close(ready[1]);
+  ::close(go[0]);
+
+  char status = 0;
+  if(server < 0 || ::read(ready[0], &status, 1) != 1 || !status)
+  {
+    terminal::write("%s - %s: mock server did not start\n", UNIT_NAME, "FAILURE");
+    return EXIT_FAILURE;
+  }
+  ::close(ready[0]);
+
+  terminal::write("%s - %s protocol: %u keys in %u configs, %u changes every %u ms\n",
+                  UNIT_NAME, director ? "director" : "io",
+                  keys, director ? configs : 1, changes, interval);
+
+  int result;
+  {
+    Application app;
+    if(director)
+    {
+      DirectorConfigClient client(socket_path, image_path);
+      result = measure(app, client, changes, interval, go[1],
+              [&client]() noexcept -> const std::string& { return client.get("provider0", "/Settings/Bench"); },
+              [&client]() noexcept
+              {
+                size_t pool_bytes = 0;
+                size_t map_bytes = 0;
+                size_t table_bytes = 0;
+                for(const auto& entry : client.memoryReport(pool_bytes))
+                {
+                  map_bytes += entry.map_bytes;
+                  table_bytes += entry.table_bytes;
+                }
+                terminal::write("%s - storage: %zu bytes in tables + %zu bytes of strings (%zu bytes as maps)\n",
+                                UNIT_NAME, table_bytes, pool_bytes, map_bytes);
+              });
+    }
+    else
+    {
+      ConfigClient client(socket_path);
+      result = measure(app, client, changes, interval, go[1],
+                       [&client]() noexcept -> const std::string& { return client.get("/Settings/Bench"); },
+                       []() noexcept { });
+    }
+  }
+
+  int server_status = 0;
+  if(result != EXIT_SUCCESS)
+    ::kill(server, SIGTERM); // it is still waiting for the benchmark to end
+  if(::waitpid(server, &server_status, 0) != server || // closing 'go' ends a server that served everything
+     !WIFEXITED(server_status) ||
+     WEXITSTATUS(server_status) != EXIT_SUCCESS)
+    result = EXIT_FAILURE;
+  ::unlink(image_path.c_str());
+  ::rmdir(directory);
+
+  if(result == EXIT_SUCCESS)
+    terminal::write("%s - %s\n", UNIT_NAME, "SUCCESS");
+  return result;
+}
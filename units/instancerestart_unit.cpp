@@ -0,0 +1,113 @@
+#include <climits>
+#include <algorithm>
+
+#include <put/cxxutils/posix_helpers.h>
+#include <put/cxxutils/vterm.h>
+
+#include <put/application.h>
+#include <put/object.h>
+
+#include <signal.h>
+
+#include "../jobcontainer.h"
+#include "../timerwheel.h"
+
+#define UNIT_NAME "instancerestart_unit"
+
+// instances directly started by this process
+static std::list<pid_t> instance_pids(JobContainer& job) noexcept
+{
+  std::list<pid_t> pids;
+  for(const std::pair<pid_t, pid_t>& pair : job.getPids())
+    if(pair.first == posix::getpid())
+      pids.push_back(pair.second);
+  return pids;
+}
+
+int main(int argc, char *argv[]) noexcept
+{
+  (void)argc;
+  (void)argv;
+// data
+  configmap_t options =
+  {
+    { "/Process/Executable", "/bin/sleep" },
+    { "/Process/Arguments", "60" },
+    { "/Process/Instances", "2" },
+    { "/Process/InstanceQuorum", "1" }, // losing one instance keeps the job running
+    { "/Process/StartTimeout", "1000" },
+    { "/Exiting/Timeout", "1000" },
+    { "/Exiting/Signal", "SIGTERM" },
+    { "/Exiting/ExitWaitType", "ProcessTermination" },
+  };
+
+// program
+  Application app;
+  JobContainer job("demo");
+  pid_t killed = 0;
+
+  StringPool names;
+  ConfigTable table(options);
+  provider_config_t config = compile_provider_config(table, names);
+
+  Object::connect(job.startFailure,
+                  []() noexcept
+                  {
+                    terminal::write("%s - %s: job did not start\n", UNIT_NAME, "FAILURE");
+                    Application::quit(EXIT_FAILURE);
+                  });
+
+  Object::connect(job.quorumLost,
+                  []() noexcept
+                  {
+                    terminal::write("%s - %s: one lost instance lost the quorum\n", UNIT_NAME, "FAILURE");
+                    Application::quit(EXIT_FAILURE);
+                  });
+
+  Object::connect(job.stopFailure,
+                  []() noexcept
+                  {
+                    terminal::write("%s - %s: job did not stop\n", UNIT_NAME, "FAILURE");
+                    Application::quit(EXIT_FAILURE);
+                  });
+
+  Object::connect(job.startSuccess,
+                  [&job, &config, &killed]() noexcept
+                  {
+                    std::list<pid_t> pids = instance_pids(job);
+                    if(pids.size() != 2)
+                    {
+                      terminal::write("%s - %s: expected 2 instances\n", UNIT_NAME, "FAILURE");
+                      Application::quit(EXIT_FAILURE);
+                      return;
+                    }
+                    killed = pids.front();
+                    ::kill(killed, SIGKILL); // the other instance keeps the quorum
+
+                    // the first restart waits DIRECTOR_RESTART_BACKOFF
+                    TimerWheel::instance().schedule(DIRECTOR_RESTART_BACKOFF + 1000,
+                                                    [&job, &config, &killed]() noexcept
+                                                    {
+                                                      std::list<pid_t> pids = instance_pids(job);
+                                                      if(pids.size() != 2 ||
+                                                         std::find(pids.begin(), pids.end(), killed) != pids.end())
+                                                      {
+                                                        terminal::write("%s - %s: the instance was not restarted\n", UNIT_NAME, "FAILURE");
+                                                        Application::quit(EXIT_FAILURE);
+                                                        return;
+                                                      }
+                                                      job.stop(config);
+                                                    });
+                  });
+
+  Object::connect(job.stopSuccess,
+                  []() noexcept
+                  {
+                    terminal::write("%s - %s\n", UNIT_NAME, "SUCCESS");
+                    Application::quit(EXIT_SUCCESS);
+                  });
+
+  job.start(config, names, table);
+
+  return app.exec();
+}
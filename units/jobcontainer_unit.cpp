@@ -18,22 +18,25 @@
 int main(int argc, char *argv[]) noexcept
 {
 // data
-  std::string exit_type("HaltServices");
   std::list<std::string> services =
   {
     "unittest/demo"
   };
-  std::unordered_map<std::string, std::string> options =
+  configmap_t options =
   {
     { "/Process/Executable", "process_control_unit.elf" },
     { "/Process/User", "unittest" },
     { "/Process/Group", "unittest" },
+    { "/Process/ProvidedServices", "unittest/demo" },
+    { "/Process/StartTimeout", "1000" },
+    { "/Exiting/Timeout", "1000" },
+    { "/Exiting/Signal", "SIGQUIT" },
+    { "/Exiting/ExitWaitType", "HaltServices" },
   };
   std::string stop_signal("SIGQUIT");
 
 // program
   std::string arguments;
-  posix::Signal::EId stop_signal_id = decode_signal_name(stop_signal);
 
   Application app;
   JobContainer job("demo");
@@ -47,6 +50,10 @@ int main(int argc, char *argv[]) noexcept
 
   options["/Process/Arguments"] = arguments;
 
+  StringPool names;
+  ConfigTable table(options);
+  provider_config_t config = compile_provider_config(table, names);
+
   Object::connect(job.startFailure,
                   []() noexcept
                   {
@@ -62,8 +69,8 @@ int main(int argc, char *argv[]) noexcept
                   });
 
   Object::connect(job.startSuccess,
-                  [&job, &services, stop_signal_id, &exit_type]() noexcept
-                  { job.stop(seconds(1), services, stop_signal_id, exit_type); });
+                  [&job, &config]() noexcept
+                  { job.stop(config); });
 
   Object::connect(job.stopSuccess,
                   []() noexcept
@@ -72,9 +79,7 @@ int main(int argc, char *argv[]) noexcept
                     Application::quit(EXIT_SUCCESS);
                   });
 
-  job.start(seconds(1),
-             services,
-             options);
+  job.start(config, names, table);
 
   return app.exec();
 }
@@ -0,0 +1,41 @@
+#include <put/application.h>
+#include <put/cxxutils/vterm.h>
+
+#include <stdlib.h>
+
+#include "mockconfigserver.h"
+#include "../configclient.h"
+#include "../directorconfigclient.h"
+
+#define UNIT_NAME "mockconfig_server"
+
+// usage: mockconfig_server.elf <directory> [keys] [configs]
+// Serves both config protocols until killed.  <directory> stands for SCFS_PATH "/" CONFIG_USERNAME,
+// so a director built with SCFS_PATH set to its parent connects to this server.
+int main(int argc, char *argv[]) noexcept
+{
+  if(argc < 2)
+  {
+    terminal::write("usage: %s <directory> [keys] [configs]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  std::string directory = argv[1];
+  uint32_t keys    = argc > 2 ? uint32_t(::strtoul(argv[2], nullptr, 10)) : 1000;
+  uint32_t configs = argc > 3 ? uint32_t(::strtoul(argv[3], nullptr, 10)) : 10;
+
+  Application app;
+  MockConfigServer io(MockConfigServer::protocol_t::Io, directory + "/io");
+  MockConfigServer director(MockConfigServer::protocol_t::Director, directory + "/" DIRECTOR_USERNAME);
+
+  if(!io.isBound() || !director.isBound())
+  {
+    terminal::write("%s - %s: unable to bind sockets in %s\n", UNIT_NAME, "FAILURE", directory.c_str());
+    return EXIT_FAILURE;
+  }
+
+  io.populate(keys, 1);
+  director.populate(keys, configs);
+  terminal::write("%s - serving %u keys from %s\n", UNIT_NAME, keys, directory.c_str());
+  return app.exec();
+}
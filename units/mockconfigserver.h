@@ -0,0 +1,408 @@
+#ifndef MOCKCONFIGSERVER_H
+#define MOCKCONFIGSERVER_H
+
+// STL
+#include <string>
+#include <map>
+#include <set>
+#include <list>
+#include <deque>
+#include <vector>
+#include <unordered_map>
+
+// PUT
+#include <put/socket.h>
+#include <put/object.h>
+#include <put/cxxutils/vfifo.h>
+#include <put/cxxutils/hashing.h>
+#include <put/cxxutils/posix_helpers.h>
+
+// POSIX
+#include <unistd.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+
+// Director
+#include "../configmap.h"
+#include "../snapshot.h"
+
+#ifndef MOCK_HISTORY_LIMIT
+#define MOCK_HISTORY_LIMIT  0x10000 // changes kept for delta syncs
+#endif
+
+// Stand-in for the config daemon: serves config.incant (Io) or directorconfig.incant (Director)
+// from memory so that the clients can be tested and measured without the real daemon.
+class MockConfigServer : public ServerSocket
+{
+public:
+  enum class protocol_t
+  {
+    Io, // key, value
+    Director, // config, key, value
+  };
+
+  MockConfigServer(protocol_t protocol, const std::string& socket_path) noexcept
+    : m_protocol(protocol),
+      m_path(socket_path),
+      m_instance(new_instance()),
+      m_generation(1),
+      m_history_base(1),
+      m_write_failures(0)
+  {
+    Object::connect(newPeerRequest, this, &MockConfigServer::request);
+    Object::connect(newPeerMessage, this, &MockConfigServer::receive);
+    Object::connect(disconnectedPeer, this, &MockConfigServer::disconnected);
+    ::unlink(m_path.c_str()); // remove a stale socket file
+    m_bound = bind(m_path.c_str());
+  }
+
+  ~MockConfigServer(void) noexcept
+  {
+    ::unlink(m_path.c_str());
+  }
+
+  bool isBound(void) const noexcept { return m_bound; }
+  uint64_t instance(void) const noexcept { return m_instance; }
+  uint64_t generation(void) const noexcept { return m_generation; }
+  uint64_t writeFailures(void) const noexcept { return m_write_failures; } // messages a peer never received
+  posix::size_t peerCount(void) const noexcept { return m_peers.size(); }
+
+  // change the data and push it to every peer (the Io protocol ignores 'config')
+  void set(const std::string& config, const std::string& key, const std::string& value) noexcept
+  {
+    assign_value(m_data[config], std::string(key), std::string(value));
+    record(true, config, key, value);
+  }
+
+  void unset(const std::string& config, const std::string& key) noexcept
+  {
+    auto iter = m_data.find(config);
+    if(iter != m_data.end())
+    {
+      erase_prefix(iter->second, key);
+      if(iter->second.empty())
+        m_data.erase(iter);
+    }
+    record(false, config, key, std::string());
+  }
+
+  // 'keys' values spread over 'configs' configs as one change set
+  void populate(uint32_t keys, uint32_t configs) noexcept
+  {
+    if(!configs || m_protocol == protocol_t::Io)
+      configs = 1;
+    for(uint32_t i = 0; i < keys; ++i)
+      set(m_protocol == protocol_t::Director ? "provider" + std::to_string(i % configs) : std::string(),
+          "/Settings/Key" + std::to_string(i / configs),
+          "value" + std::to_string(i));
+    commit();
+  }
+
+  // end a change set: peers are told the new generation
+  void commit(void) noexcept
+  {
+    ++m_generation;
+    for(posix::fd_t peer : m_peers)
+      send(peer, vfifo("RPC", "generation", m_instance, m_generation));
+  }
+
+private:
+  struct change_t
+  {
+    uint64_t generation; // generation the change is part of
+    bool is_set;
+    std::string config;
+    std::string key;
+    std::string value;
+  };
+
+  void record(bool is_set, const std::string& config, const std::string& key, const std::string& value) noexcept
+  {
+    m_history.push_back({ m_generation + 1, is_set, config, key, value });
+    while(m_history.size() > MOCK_HISTORY_LIMIT)
+    {
+      m_history_base = m_history.front().generation;
+      m_history.pop_front();
+    }
+    for(posix::fd_t peer : m_peers)
+      push(peer, m_history.back());
+  }
+
+  bool isSubscribed(posix::fd_t peer, const std::string& key) const noexcept
+  {
+    auto iter = m_subscriptions.find(peer);
+    if(iter == m_subscriptions.end() || iter->second.empty())
+      return true;
+    for(const std::string& prefix : iter->second)
+      if(prefix_related(key, prefix))
+        return true;
+    return false;
+  }
+
+  bool send(posix::fd_t peer, const vfifo& buffer, posix::fd_t fd = posix::invalid_descriptor) noexcept
+  {
+    if(write(peer, buffer, fd))
+      return true;
+    ++m_write_failures;
+    return false;
+  }
+
+  bool push(posix::fd_t peer, const change_t& change) noexcept
+  {
+    if(!isSubscribed(peer, change.key))
+      return true;
+    if(m_protocol == protocol_t::Director)
+      return change.is_set ?
+            send(peer, vfifo("RPC", "valueSet", change.config, change.key, change.value)) :
+            send(peer, vfifo("RPC", "valueUnset", change.config, change.key));
+    return change.is_set ?
+          send(peer, vfifo("RPC", "valueSet", change.key, change.value)) :
+          send(peer, vfifo("RPC", "valueUnset", change.key));
+  }
+
+  // every subscribed value in snapshot.h format, in a sealed memory file (clients refuse unsealed ones)
+  posix::fd_t snapshot(posix::fd_t peer) const noexcept
+  {
+    std::vector<char> buffer;
+    auto append = [&buffer](const void* data, uint32_t size) noexcept
+      { buffer.insert(buffer.end(), static_cast<const char*>(data), static_cast<const char*>(data) + size); };
+    auto field = [&append](const std::string& str) noexcept
+      { uint32_t size = uint32_t(str.size()); append(&size, sizeof(size)); append(str.data(), size); };
+
+    uint32_t header[3] = { m_protocol == protocol_t::Director ? uint32_t(DIRECTOR_CONFIG_SNAPSHOT_MAGIC) : uint32_t(CONFIG_SNAPSHOT_MAGIC),
+                           m_protocol == protocol_t::Director ? 3u : 2u,
+                           0 };
+    append(header, sizeof(header));
+    for(const auto& config : m_data) // entries stay grouped by config
+      for(const auto& pair : config.second)
+        if(isSubscribed(peer, pair.first))
+        {
+          if(m_protocol == protocol_t::Director)
+            field(config.first);
+          field(pair.first);
+          field(pair.second);
+          ++header[2];
+        }
+    posix::memcpy(buffer.data() + sizeof(uint32_t) * 2, &header[2], sizeof(uint32_t));
+
+#if defined(MFD_ALLOW_SEALING)
+    posix::fd_t fd = ::memfd_create("snapshot", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+#else
+    posix::fd_t fd = posix::invalid_descriptor;
+    errno = ENOSYS;
+#endif
+    if(fd == posix::invalid_descriptor)
+      return fd;
+    if(::write(fd, buffer.data(), buffer.size()) != posix::ssize_t(buffer.size())
+#if defined(F_ADD_SEALS)
+       || ::fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL) == posix::error_response
+#endif
+       )
+    {
+      posix::close(fd);
+      return posix::invalid_descriptor;
+    }
+    return fd;
+  }
+
+  void request(posix::fd_t socket, posix::sockaddr_t addr, proccred_t cred) noexcept
+  {
+    (void)addr;
+    (void)cred;
+    if(acceptPeerRequest(socket))
+      m_peers.insert(socket);
+  }
+
+  void disconnected(posix::fd_t socket) noexcept
+  {
+    m_peers.erase(socket);
+    m_subscriptions.erase(socket);
+  }
+
+  void receive(posix::fd_t socket, vfifo buffer, posix::fd_t fd) noexcept
+  {
+    std::string str, config, key, value;
+    if(fd != posix::invalid_descriptor) // no call passes a descriptor
+      posix::close(fd);
+
+    if((buffer >> str).hadError() || str != "RPC" ||
+       (buffer >> str).hadError())
+      return;
+
+    bool director = m_protocol == protocol_t::Director;
+    switch(hash(str))
+    {
+      case "syncCall"_hash:
+        for(const auto& config_data : m_data)
+          for(const auto& pair : config_data.second)
+            push(socket, { m_generation, true, config_data.first, pair.first, pair.second });
+        send(socket, vfifo("RPC", "syncReturn", posix::error_t(posix::success_response), m_instance, m_generation));
+        break;
+
+      case "syncSnapshotCall"_hash:
+      {
+        posix::fd_t snapshot_fd = snapshot(socket);
+        send(socket, vfifo("RPC", "syncSnapshotReturn",
+                           posix::error_t(snapshot_fd == posix::invalid_descriptor ? errno : posix::success_response),
+                           m_instance,
+                           m_generation),
+            snapshot_fd);
+        if(snapshot_fd != posix::invalid_descriptor)
+          posix::close(snapshot_fd);
+      }
+      break;
+
+      case "syncDeltaCall"_hash:
+      {
+        uint64_t instance = 0, generation = 0;
+        buffer >> instance >> generation;
+        if(buffer.hadError() ||
+           instance != m_instance || // numbered by another server
+           generation < m_history_base || generation > m_generation) // if the delta is unknown
+        {
+          send(socket, vfifo("RPC", "syncDeltaReturn", posix::error_t(posix::errc::invalid_argument), m_instance, m_generation));
+          break;
+        }
+        for(const change_t& change : m_history)
+          if(change.generation > generation)
+            push(socket, change);
+        send(socket, vfifo("RPC", "syncDeltaReturn", posix::error_t(posix::success_response), m_instance, m_generation));
+      }
+      break;
+
+      case "subscribeCall"_hash:
+      {
+        uint32_t count = 0;
+        std::vector<std::string>& prefixes = m_subscriptions[socket];
+        prefixes.clear();
+        buffer >> count;
+        for(uint32_t i = 0; !buffer.hadError() && i < count; ++i)
+          if(!(buffer >> str).hadError())
+            prefixes.push_back(str);
+        send(socket, vfifo("RPC", "subscribeReturn",
+                           posix::error_t(buffer.hadError() ? posix::error_t(posix::errc::invalid_argument) : posix::success_response)));
+      }
+      break;
+
+      case "listConfigsCall"_hash:
+      {
+        std::list<std::string> names;
+        for(const auto& config_data : m_data)
+          names.push_back(config_data.first);
+        send(socket, vfifo("RPC", "listConfigsReturn", names));
+      }
+      break;
+
+      case "setCall"_hash:
+        if(director)
+          buffer >> config;
+        buffer >> key >> value;
+        if(!buffer.hadError())
+        {
+          set(config, key, value);
+          commit();
+        }
+        if(director)
+          send(socket, vfifo("RPC", "setReturn", status(buffer), config, key));
+        else
+          send(socket, vfifo("RPC", "setReturn", status(buffer), key));
+        break;
+
+      case "unsetCall"_hash:
+        if(director)
+          buffer >> config;
+        buffer >> key;
+        if(!buffer.hadError())
+        {
+          unset(config, key);
+          commit();
+        }
+        if(director)
+          send(socket, vfifo("RPC", "unsetReturn", status(buffer), config, key));
+        else
+          send(socket, vfifo("RPC", "unsetReturn", status(buffer), key));
+        break;
+
+      case "getCall"_hash:
+      {
+        if(director)
+          buffer >> config;
+        buffer >> key;
+        std::list<std::string> children;
+        auto config_data = m_data.find(config);
+        if(!buffer.hadError() && config_data != m_data.end())
+        {
+          auto iter = config_data->second.find(key);
+          if(iter != config_data->second.end())
+            value = iter->second;
+          auto range = prefix_range(config_data->second, key + '/');
+          for(auto child = range.first; child != range.second; ++child)
+            children.push_back(child->first);
+        }
+        if(director)
+          send(socket, vfifo("RPC", "getReturn", status(buffer), config, key, value, children));
+        else
+          send(socket, vfifo("RPC", "getReturn", status(buffer), value, children));
+      }
+      break;
+
+      case "batchCall"_hash:
+      {
+        uint32_t count = 0;
+        std::list<change_t> changes; // parse everything before applying anything
+        buffer >> count;
+        for(uint32_t i = 0; !buffer.hadError() && i < count; ++i)
+        {
+          buffer >> str;
+          if(director)
+            buffer >> config;
+          buffer >> key >> value;
+          changes.push_back({ 0, str == "set", config, key, value });
+        }
+        if(!buffer.hadError())
+        {
+          for(const change_t& change : changes)
+          {
+            if(change.is_set)
+              set(change.config, change.key, change.value);
+            else
+              unset(change.config, change.key);
+          }
+          commit();
+        }
+        send(socket, vfifo("RPC", "batchReturn", status(buffer), buffer.hadError() ? uint32_t(0) : count));
+      }
+      break;
+    }
+  }
+
+  static posix::error_t status(const vfifo& buffer) noexcept
+  {
+    return buffer.hadError() ? posix::error_t(posix::errc::invalid_argument) : posix::error_t(posix::success_response);
+  }
+
+  static uint64_t new_instance(void) noexcept
+  {
+    struct timespec now;
+    ::clock_gettime(CLOCK_REALTIME, &now);
+    uint64_t instance = (uint64_t(posix::getpid()) << 40) ^ (uint64_t(now.tv_sec) << 20) ^ uint64_t(now.tv_nsec);
+    return instance ? instance : 1;
+  }
+
+  protocol_t m_protocol;
+  std::string m_path;
+  bool m_bound;
+  uint64_t m_instance; // differs for every server started: generations of another one mean nothing
+  uint64_t m_generation;
+  uint64_t m_history_base; // oldest generation a delta can start from
+  uint64_t m_write_failures;
+  std::map<std::string, configmap_t> m_data; // by config (a single unnamed config for Io)
+  std::deque<change_t> m_history;
+  std::set<posix::fd_t> m_peers;
+  std::unordered_map<posix::fd_t, std::vector<std::string>> m_subscriptions;
+};
+
+#endif // MOCKCONFIGSERVER_H
@@ -0,0 +1,101 @@
+#include <map>
+#include <string>
+#include <cstdlib>
+
+#include <put/cxxutils/vterm.h>
+
+#include "../dependencysolver.h"
+
+#define UNIT_NAME "restartorder_unit"
+
+// providers and runlevels held in memory
+class RestartDemo : public DependencySolver
+{
+public:
+  RestartDemo(const std::map<std::string, std::map<std::string, std::string>>& config_data) noexcept
+    : m_config_data(config_data) { }
+
+  const std::string& getConfigValue(const std::string& config, const std::string& key) const noexcept
+  {
+    static const std::string bad;
+    auto iter = m_config_data.find(config);
+    if(iter != m_config_data.end())
+    {
+      auto subiter = iter->second.find(key);
+      if(subiter != iter->second.end())
+        return subiter->second;
+    }
+    return bad;
+  }
+
+  std::list<std::string> getConfigList(void) const noexcept
+  {
+    std::list<std::string> config_list;
+    for(const auto& pair : m_config_data)
+      config_list.push_back(pair.first);
+    return config_list;
+  }
+
+  runlevel_t getRunlevelNumber(const std::string& rlname) const noexcept
+    { return rlname == "1" ? 1 : invalid_runlevel; }
+
+private:
+  std::map<std::string, std::map<std::string, std::string>> m_config_data;
+};
+
+int main(int, char**) noexcept
+{
+  // base <- middle <- top, other is unrelated
+  RestartDemo demo({
+                     { "base",
+                       {
+                         { "/Requirements/StartOnRunLevels", "1" },
+                         { "/Process/ProvidedServices", "demo/base" },
+                       }
+                     },
+                     { "middle",
+                       {
+                         { "/Requirements/StartOnRunLevels", "1" },
+                         { "/Requirements/ActiveProviders", "base" },
+                       }
+                     },
+                     { "top",
+                       {
+                         { "/Requirements/StartOnRunLevels", "1" },
+                         { "/Requirements/ActiveProviders", "middle" },
+                       }
+                     },
+                     { "other",
+                       {
+                         { "/Requirements/StartOnRunLevels", "1" },
+                       }
+                     },
+                   });
+  demo.resolveDependencies();
+
+  // dependents stop deepest first, then everything starts again from the failed provider outward
+  const std::pair<bool, std::string> expected[] =
+  {
+    { false, "top" },
+    { false, "middle" },
+    { true , "base" },
+    { true , "middle" },
+    { true , "top" },
+  };
+
+  DependencySolver::runlevel_actions_t actions = demo.getRestartOrder("base", { "base", "middle", "top", "other" });
+  bool ok = actions.size() == sizeof(expected) / sizeof(expected[0]);
+  for(posix::size_t i = 0; ok && !actions.empty(); ++i, actions.pop())
+    ok = actions.front() == expected[i];
+
+  // a provider without dependents restarts alone
+  actions = demo.getRestartOrder("other", { "base", "middle", "top", "other" });
+  ok = ok && actions.size() == 1 && actions.front() == std::make_pair(true, std::string("other"));
+
+  // stopped dependents stay stopped
+  actions = demo.getRestartOrder("base", { "base" });
+  ok = ok && actions.size() == 1 && actions.front() == std::make_pair(true, std::string("base"));
+
+  terminal::write("%s - %s\n", UNIT_NAME, ok ? "SUCCESS" : "FAILURE");
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
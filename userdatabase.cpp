@@ -0,0 +1,226 @@
+#include "userdatabase.h"
+
+// STL
+#include <algorithm>
+
+// Director
+#include "configloader.h"
+#include "string_helpers.h"
+
+// POSIX
+#include <grp.h>
+#include <pwd.h>
+
+static bool all_digits(const std::string& str) noexcept
+{
+  for(char c : str)
+    if(!posix::isdigit(c))
+      return false;
+  return !str.empty();
+}
+
+// split one line of a colon separated database
+static std::vector<std::string> split_fields(const std::string& line) noexcept
+{
+  std::vector<std::string> fields(1);
+  for(char c : line)
+  {
+    if(c == ':')
+      fields.emplace_back();
+    else
+      fields.back().push_back(c);
+  }
+  return fields;
+}
+
+// call 'parse' with every line that is neither empty, a comment nor an NIS entry
+template<typename function_type>
+static void for_each_entry(const std::string& buffer, function_type parse) noexcept
+{
+  std::string::size_type pos = 0;
+  while(pos < buffer.size())
+  {
+    std::string::size_type end = buffer.find('\n', pos);
+    if(end == std::string::npos)
+      end = buffer.size();
+    if(end > pos && buffer[pos] != '#' && buffer[pos] != '+' && buffer[pos] != '-')
+      parse(split_fields(buffer.substr(pos, end - pos)));
+    pos = end + 1;
+  }
+}
+
+UserDatabase& UserDatabase::instance(void) noexcept
+{
+  static UserDatabase database;
+  return database;
+}
+
+bool UserDatabase::load(void) noexcept
+{
+  m_users.clear();
+  m_user_names.clear();
+  m_groups.clear();
+  m_group_names.clear();
+  m_memberships.clear();
+  m_nss_users.clear();
+  m_missing_users.clear();
+  m_missing_groups.clear();
+  m_loaded = true;
+
+  std::string buffer;
+  bool passwd_read = read_config_file(USER_DATABASE_DIR "/" USER_DATABASE_PASSWD, buffer);
+  if(passwd_read)
+    parsePasswd(buffer);
+  bool group_read = read_config_file(USER_DATABASE_DIR "/" USER_DATABASE_GROUP, buffer);
+  if(group_read)
+    parseGroup(buffer);
+  return passwd_read || group_read;
+}
+
+void UserDatabase::parsePasswd(const std::string& buffer) noexcept
+{
+  for_each_entry(buffer,
+                 [this](const std::vector<std::string>& fields) noexcept
+                 {
+                   // name:password:uid:gid:gecos:home:shell
+                   if(fields.size() >= 4 && !fields[0].empty() && all_digits(fields[2]) && all_digits(fields[3]))
+                     addUser(fields[0], uid_t(convert_to_unsigned(fields[2], 0)), gid_t(convert_to_unsigned(fields[3], 0)));
+                 });
+}
+
+void UserDatabase::parseGroup(const std::string& buffer) noexcept
+{
+  for_each_entry(buffer,
+                 [this](const std::vector<std::string>& fields) noexcept
+                 {
+                   // name:password:gid:member,member
+                   if(fields.size() < 3 || fields[0].empty() || !all_digits(fields[2]))
+                     return;
+                   gid_t gid = gid_t(convert_to_unsigned(fields[2], 0));
+                   addGroup(fields[0], gid);
+                   if(fields.size() > 3)
+                     for(const std::string& member : clean_explode(fields[3], ','))
+                       m_memberships[member].push_back(gid);
+                 });
+}
+
+void UserDatabase::addUser(const std::string& name, uid_t uid, gid_t gid) noexcept
+{
+  m_users.emplace(name, user_t { uid, gid }); // the first entry wins, as with getpwnam()
+  m_user_names.emplace(uid, name);
+}
+
+void UserDatabase::addGroup(const std::string& name, gid_t gid) noexcept
+{
+  m_groups.emplace(name, gid);
+  m_group_names.emplace(gid, name);
+}
+
+bool UserDatabase::findUser(const std::string& name, uid_t& uid, gid_t& gid) noexcept
+{
+  if(!m_loaded)
+    load();
+
+  if(all_digits(name))
+  {
+    uid = uid_t(convert_to_unsigned(name, 0));
+    auto iter = m_user_names.find(uid);
+    gid = iter == m_user_names.end() ? gid_t(uid) : m_users[iter->second].gid;
+    return true;
+  }
+
+  auto iter = m_users.find(name);
+  if(iter == m_users.end())
+  {
+    if(m_missing_users.count(name)) // NSS was already asked
+      return false;
+    struct passwd* entry = ::getpwnam(name.c_str()); // not in the files: the account may come from NSS
+    if(entry == nullptr)
+    {
+      m_missing_users.insert(name);
+      return false;
+    }
+    addUser(name, entry->pw_uid, entry->pw_gid);
+    m_nss_users.insert(name);
+    iter = m_users.find(name);
+  }
+  uid = iter->second.uid;
+  gid = iter->second.gid;
+  return true;
+}
+
+bool UserDatabase::findGroup(const std::string& name, gid_t& gid) noexcept
+{
+  if(!m_loaded)
+    load();
+
+  if(all_digits(name))
+  {
+    gid = gid_t(convert_to_unsigned(name, 0));
+    return true;
+  }
+
+  auto iter = m_groups.find(name);
+  if(iter == m_groups.end())
+  {
+    if(m_missing_groups.count(name)) // NSS was already asked
+      return false;
+    struct group* entry = ::getgrnam(name.c_str());
+    if(entry == nullptr)
+    {
+      m_missing_groups.insert(name);
+      return false;
+    }
+    addGroup(name, entry->gr_gid);
+    iter = m_groups.find(name);
+  }
+  gid = iter->second;
+  return true;
+}
+
+const std::string& UserDatabase::userName(uid_t uid) noexcept
+{
+  static const std::string unknown;
+  if(!m_loaded)
+    load();
+  auto iter = m_user_names.find(uid);
+  return iter == m_user_names.end() ? unknown : iter->second;
+}
+
+const std::string& UserDatabase::groupName(gid_t gid) noexcept
+{
+  static const std::string unknown;
+  if(!m_loaded)
+    load();
+  auto iter = m_group_names.find(gid);
+  return iter == m_group_names.end() ? unknown : iter->second;
+}
+
+std::vector<gid_t> UserDatabase::memberGroups(const std::string& user, gid_t primary_gid) noexcept
+{
+  if(!m_loaded)
+    load();
+  std::vector<gid_t> groups = { primary_gid };
+  if(m_nss_users.count(user) && !m_memberships.count(user)) // the group files may not list this user: ask NSS once
+  {
+    std::vector<gid_t>& members = m_memberships[user];
+    int count = 16;
+    members.resize(posix::size_t(count));
+    while(::getgrouplist(user.c_str(), primary_gid, members.data(), &count) == posix::error_response)
+    {
+      if(posix::size_t(count) <= members.size()) // failed without asking for more room
+      {
+        count = 0;
+        break;
+      }
+      members.resize(posix::size_t(count));
+    }
+    members.resize(posix::size_t(count));
+  }
+  auto iter = m_memberships.find(user);
+  if(iter != m_memberships.end())
+    for(gid_t gid : iter->second)
+      if(std::find(groups.begin(), groups.end(), gid) == groups.end())
+        groups.push_back(gid);
+  return groups;
+}
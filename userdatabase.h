@@ -0,0 +1,72 @@
+#ifndef USERDATABASE_H
+#define USERDATABASE_H
+
+// STL
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+
+// PUT
+#include <put/cxxutils/posix_helpers.h>
+
+// POSIX
+#include <sys/types.h>
+
+#ifndef USER_DATABASE_DIR
+#define USER_DATABASE_DIR   "/etc"
+#endif
+
+#ifndef USER_DATABASE_PASSWD
+#define USER_DATABASE_PASSWD  "passwd"
+#endif
+
+#ifndef USER_DATABASE_GROUP
+#define USER_DATABASE_GROUP   "group"
+#endif
+
+// Users and groups read straight from the passwd and group files, so that resolving
+// credentials is a hash lookup and does not depend on NSS (which may not be usable early in boot).
+// Names missing from the files are asked of NSS once and the answer (found or not) is remembered until the next load.
+class UserDatabase
+{
+public:
+  static UserDatabase& instance(void) noexcept;
+
+  bool load(void) noexcept; // (re)read both files, false if neither could be read
+
+  bool findUser(const std::string& name, uid_t& uid, gid_t& gid) noexcept; // name or numeric ID
+  bool findGroup(const std::string& name, gid_t& gid) noexcept; // name or numeric ID
+  const std::string& userName(uid_t uid) noexcept; // empty if unknown
+  const std::string& groupName(gid_t gid) noexcept; // empty if unknown
+  std::vector<gid_t> memberGroups(const std::string& user, gid_t primary_gid) noexcept; // primary group first
+
+  posix::size_t userCount(void) const noexcept { return m_users.size(); }
+  posix::size_t groupCount(void) const noexcept { return m_groups.size(); }
+
+private:
+  UserDatabase(void) noexcept : m_loaded(false) { }
+
+  struct user_t
+  {
+    uid_t uid;
+    gid_t gid;
+  };
+
+  void parsePasswd(const std::string& buffer) noexcept;
+  void parseGroup(const std::string& buffer) noexcept;
+  void addUser(const std::string& name, uid_t uid, gid_t gid) noexcept;
+  void addGroup(const std::string& name, gid_t gid) noexcept;
+
+  bool m_loaded;
+  std::unordered_map<std::string, user_t> m_users;
+  std::unordered_map<uid_t, std::string> m_user_names;
+  std::unordered_map<std::string, gid_t> m_groups;
+  std::unordered_map<gid_t, std::string> m_group_names;
+  std::unordered_map<std::string, std::vector<gid_t>> m_memberships; // supplementary groups by user name
+  std::unordered_set<std::string> m_nss_users; // users found through NSS: their groups are asked of NSS too
+  std::unordered_set<std::string> m_missing_users; // names NSS did not know
+  std::unordered_set<std::string> m_missing_groups;
+};
+
+#endif // USERDATABASE_H
@@ -0,0 +1,93 @@
+#include "workerpool.h"
+
+// PUT
+#include <put/object.h>
+
+WorkerPool& WorkerPool::instance(void) noexcept
+{
+  static WorkerPool pool;
+  return pool;
+}
+
+#ifdef SINGLE_THREADED_APPLICATION
+WorkerPool::WorkerPool(void) noexcept { }
+WorkerPool::~WorkerPool(void) noexcept { }
+
+// no threads: do the work now but still complete from the event loop
+void WorkerPool::post(task_t work, task_t completion) noexcept
+{
+  if(work)
+    work();
+  complete(completion);
+}
+
+posix::size_t WorkerPool::pending(void) const noexcept
+{
+  return 0;
+}
+#else
+WorkerPool::WorkerPool(void) noexcept
+  : m_running(0),
+    m_stopping(false)
+{
+}
+
+WorkerPool::~WorkerPool(void) noexcept
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stopping = true;
+    m_jobs.clear(); // nothing can complete anymore
+  }
+  m_condition.notify_all();
+  for(std::thread& thread : m_threads)
+    thread.join();
+}
+
+void WorkerPool::post(task_t work, task_t completion) noexcept
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_jobs.push_back({ work, completion });
+    if(m_threads.size() < WORKERPOOL_THREADS &&
+       m_threads.size() < m_jobs.size() + m_running) // if every thread is busy
+      m_threads.emplace_back(&WorkerPool::run, this);
+  }
+  m_condition.notify_one();
+}
+
+posix::size_t WorkerPool::pending(void) const noexcept
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_jobs.size() + m_running;
+}
+
+void WorkerPool::run(void) noexcept
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  for(;;)
+  {
+    m_condition.wait(lock, [this]() noexcept { return m_stopping || !m_jobs.empty(); });
+    if(m_stopping)
+      return;
+
+    job_t job = std::move(m_jobs.front());
+    m_jobs.pop_front();
+    ++m_running;
+    lock.unlock();
+
+    if(job.work)
+      job.work();
+    complete(job.completion);
+
+    lock.lock();
+    --m_running;
+  }
+}
+#endif
+
+void WorkerPool::complete(task_t& completion) noexcept
+{
+  if(completion)
+    Object::singleShot(completion); // queued to the event loop
+}
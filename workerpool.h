@@ -0,0 +1,72 @@
+#ifndef WORKERPOOL_H
+#define WORKERPOOL_H
+
+// STL
+#include <deque>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <utility>
+
+#ifndef SINGLE_THREADED_APPLICATION
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#endif
+
+// PUT
+#include <put/cxxutils/posix_helpers.h>
+
+#ifndef WORKERPOOL_THREADS
+#define WORKERPOOL_THREADS  2 // blocking calls are short: a few threads keep the event loop free
+#endif
+
+// Runs blocking work (/proc scans, file access) off the event loop.
+// Work must only use what it was given: completions run on the event loop and may use anything.
+// JobContainers are not spread over per-core loops: PUT has one Application loop per process and its
+// ChildProcess, ProcessEvent and TimerEvent objects are only usable from it.
+class WorkerPool
+{
+public:
+  typedef std::function<void(void)> task_t;
+
+  static WorkerPool& instance(void) noexcept;
+
+  void post(task_t work, task_t completion = task_t()) noexcept;
+
+  // hand the result of 'work' to 'completion'
+  template<typename result_type>
+  void post(std::function<result_type(void)> work, std::function<void(result_type)> completion) noexcept
+  {
+    std::shared_ptr<result_type> result = std::make_shared<result_type>();
+    post([work, result]() noexcept { *result = work(); },
+         [completion, result]() noexcept { completion(std::move(*result)); });
+  }
+
+  posix::size_t pending(void) const noexcept; // work not yet finished
+
+private:
+  WorkerPool(void) noexcept;
+  ~WorkerPool(void) noexcept;
+
+  struct job_t
+  {
+    task_t work;
+    task_t completion;
+  };
+
+  static void complete(task_t& completion) noexcept;
+
+#ifndef SINGLE_THREADED_APPLICATION
+  void run(void) noexcept;
+
+  std::vector<std::thread> m_threads; // started with the first job
+  std::deque<job_t> m_jobs;
+  posix::size_t m_running;
+  bool m_stopping;
+  mutable std::mutex m_mutex;
+  std::condition_variable m_condition;
+#endif
+};
+
+#endif // WORKERPOOL_H